@@ -0,0 +1,106 @@
+// rife implemented with ncnn library
+
+#include "mapped_file.h"
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    ptr = 0;
+    len = 0;
+#if _WIN32
+    mapping = 0;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#if _WIN32
+int MappedFile::open(const std::filesystem::path& path)
+{
+    close();
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE)
+        return -1;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return -1;
+    }
+
+    mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(file);
+    if (!mapping)
+        return -1;
+
+    ptr = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!ptr)
+    {
+        CloseHandle(mapping);
+        mapping = 0;
+        return -1;
+    }
+
+    len = static_cast<size_t>(file_size.QuadPart);
+    return 0;
+}
+
+void MappedFile::close()
+{
+    if (ptr)
+        UnmapViewOfFile(ptr);
+    if (mapping)
+        CloseHandle(mapping);
+
+    ptr = 0;
+    len = 0;
+    mapping = 0;
+}
+#else
+int MappedFile::open(const std::filesystem::path& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    void* p = mmap(0, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        return -1;
+
+    ptr = static_cast<const unsigned char*>(p);
+    len = static_cast<size_t>(st.st_size);
+    return 0;
+}
+
+void MappedFile::close()
+{
+    if (ptr)
+        munmap(const_cast<unsigned char*>(ptr), len);
+
+    ptr = 0;
+    len = 0;
+}
+#endif
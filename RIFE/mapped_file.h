@@ -0,0 +1,34 @@
+// rife implemented with ncnn library
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file, used to feed model weights to ncnn without reading them
+// into a buffer first. ncnn only references the fp32 blobs in place, fp16 ones are converted.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    int open(const std::filesystem::path& path);
+    void close();
+
+    const unsigned char* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const unsigned char* ptr;
+    size_t len;
+#if _WIN32
+    void* mapping;
+#endif
+};
+
+#endif // MAPPED_FILE_H
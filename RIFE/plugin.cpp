@@ -22,38 +22,273 @@
     SOFTWARE.
 */
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
 #include <fstream>
+#include <iterator>
+#include <list>
 #include <memory>
-#include <semaphore>
+#include <mutex>
+#include <optional>
+#include <stop_token>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <VapourSynth4.h>
 #include <VSHelper4.h>
 
 #include "rife.h"
+#include "rife_borders.h"
+#include "rife_cache.h"
+#include "rife_regions.h"
+#include "rife_retime.h"
+#include "rife_scheduler.h"
+#include "rife_server.h"
+
+#ifdef RIFE_EMBEDDED_MODELS
+#include "rife_embedded.h"
+#endif
 
 using namespace std::literals;
 
-static std::atomic<int> numGPUInstances{ 0 };
+// Keeps the ncnn GPU instance and its per-device state alive between filter instances, so
+// re-evaluating a script does not recreate the Vulkan instance every time. It is torn down at
+// plugin unload, or once it has been unused for the idle timeout requested by the last user.
+class GPUInstance final {
+public:
+    static GPUInstance& get() {
+        static GPUInstance instance;
+        return instance;
+    }
+
+    bool acquire() {
+        std::lock_guard lock{ mutex };
+
+        if (!created) {
+            if (ncnn::create_gpu_instance())
+                return false;
+            created = true;
+        }
+
+        ++refs;
+        deadline.reset();
+        cv.notify_all();
+        return true;
+    }
+
+    void release(double idleTimeout) {
+        std::lock_guard lock{ mutex };
+
+        if (--refs > 0 || idleTimeout < 0.0)
+            return;
+
+        if (idleTimeout == 0.0) {
+            ncnn::destroy_gpu_instance();
+            created = false;
+            return;
+        }
+
+        deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{ idleTimeout });
+        if (!reaper.joinable())
+            reaper = std::jthread{ [this](std::stop_token stop) { reap(stop); } };
+        cv.notify_all();
+    }
+
+private:
+    GPUInstance() = default;
+
+    ~GPUInstance() {
+        if (reaper.joinable()) {
+            reaper.request_stop();
+            reaper.join();
+        }
+
+        if (created)
+            ncnn::destroy_gpu_instance();
+    }
+
+    void reap(std::stop_token stop) {
+        std::unique_lock lock{ mutex };
+
+        while (!stop.stop_requested()) {
+            if (!deadline) {
+                cv.wait(lock, stop, [this] { return deadline.has_value(); });
+                continue;
+            }
+
+            auto until{ *deadline };
+            if (cv.wait_until(lock, stop, until, [&] { return deadline != until; }))
+                continue;
+
+            if (refs == 0 && created && deadline == until) {
+                ncnn::destroy_gpu_instance();
+                created = false;
+                deadline.reset();
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable_any cv;
+    int refs{};
+    bool created{};
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    std::jthread reaper;
+};
+
+class GPUInstanceLease final {
+public:
+    GPUInstanceLease() = default;
+    GPUInstanceLease(const GPUInstanceLease&) = delete;
+    GPUInstanceLease& operator=(const GPUInstanceLease&) = delete;
+
+    ~GPUInstanceLease() {
+        if (acquired)
+            GPUInstance::get().release(idleTimeout);
+    }
+
+    bool acquire(double timeout) {
+        idleTimeout = timeout;
+        acquired = GPUInstance::get().acquire();
+        return acquired;
+    }
+
+private:
+    bool acquired{};
+    double idleTimeout{ -1.0 };
+};
+
+// Outputs of one pair of source frames for models that bisect. The first request for any of them
+// computes them all, so the midpoints are interpolated once per pair, the others only take theirs.
+struct PairOutputs final {
+    explicit PairOutputs(const VSAPI* vsapi) noexcept : vsapi{ vsapi } {}
+
+    ~PairOutputs() {
+        for (auto frame : frames)
+            vsapi->freeFrame(frame);
+    }
+
+    const VSAPI* vsapi;
+    std::mutex mutex;
+    bool done{};
+    int first{};
+    int pending{};
+    std::vector<const VSFrame*> frames;
+};
 
 struct RIFEData final {
+    GPUInstanceLease gpuInstance; // must outlive rife
     VSNode* node;
     VSNode* psnr;
+    VSNode* flow;
     VSVideoInfo vi;
     bool sceneChange;
     bool skip;
     double skipThreshold;
+    int borders;
+    float borderThreshold;
+    RIFERect activeArea;
+    bool roi;
+    float roiThreshold;
+    int roiHalo;
+    int granularity;
+    bool exportFlow;
+    int flowScale;
+    int flowChannels;
     int64_t factor;
     int64_t factorNum;
     int64_t factorDen;
-    std::unique_ptr<RIFE> rife;
-    std::unique_ptr<std::counting_semaphore<>> semaphore;
+    bool sharePairs;
+    std::vector<RIFERetimedFrame> retime;
+    std::unique_ptr<RIFEFrameCache> frameCache;
+    uint64_t cacheSeed;
+    std::vector<double> times;
+    std::shared_ptr<RIFE> rife;
+    std::shared_ptr<RIFEScheduler> scheduler;
+    int stream;
+    std::shared_ptr<RIFEClient> client;
+    int64_t clientStream;
+    mutable std::mutex pairsMutex;
+    mutable std::list<std::pair<int, std::shared_ptr<PairOutputs>>> pairs;
+    size_t outputsBudget;
+    mutable std::mutex outputsMutex;
+    mutable std::list<std::pair<int, const VSFrame*>> outputs;
+    mutable size_t outputsSize;
+    mutable int64_t outputsHits;
+    mutable int64_t outputsMisses;
 };
 
-static void filter(const VSFrame* src0, const VSFrame* src1, VSFrame* dst,
-                   const float timestep, const RIFEData* const VS_RESTRICT d, const VSAPI* vsapi) noexcept {
+// Attaches the flow of the pair, averaged over blocks of flowScale pixels, to every output of it.
+static void setFlowProps(const ncnn::Mat& flow, VSFrame* const* dsts, const int count, const RIFEData* const VS_RESTRICT d, const VSAPI* vsapi) noexcept {
+    const auto scale{ d->flowScale };
+    const auto width{ (flow.w + scale - 1) / scale };
+    const auto height{ (flow.h + scale - 1) / scale };
+
+    std::vector<double> blocks(static_cast<size_t>(width) * height * flow.c);
+    for (auto q{ 0 }; q < flow.c; q++) {
+        auto dst{ blocks.data() + static_cast<size_t>(width) * height * q };
+        for (auto y{ 0 }; y < flow.h; y++) {
+            auto row{ flow.channel(q).row(y) };
+            for (auto x{ 0 }; x < flow.w; x++)
+                dst[y / scale * width + x / scale] += row[x];
+        }
+
+        // blocks at the right and bottom edges may be cut short
+        for (auto by{ 0 }; by < height; by++) {
+            for (auto bx{ 0 }; bx < width; bx++)
+                dst[by * width + bx] /= (std::min(bx * scale + scale, flow.w) - bx * scale) * (std::min(by * scale + scale, flow.h) - by * scale);
+        }
+    }
+
+    for (auto i{ 0 }; i < count; i++) {
+        auto props{ vsapi->getFramePropertiesRW(dsts[i]) };
+        vsapi->mapSetFloatArray(props, "RIFEFlow", blocks.data(), static_cast<int>(blocks.size()));
+        vsapi->mapSetInt(props, "RIFEFlowWidth", width, maReplace);
+        vsapi->mapSetInt(props, "RIFEFlowHeight", height, maReplace);
+        vsapi->mapSetInt(props, "RIFEFlowScale", scale, maReplace);
+    }
+}
+
+// The flow export_flow attached to a frame, repeated over its blocks at the size of the frames, or
+// nothing if the frame has none of that size or with another number of components than channels.
+static ncnn::Mat getFlowProps(const VSFrame* frame, const int width, const int height, const int channels, const VSAPI* vsapi) noexcept {
+    auto props{ vsapi->getFramePropertiesRO(frame) };
+    int errWidth, errHeight, errScale;
+    auto flowWidth{ vsapi->mapGetIntSaturated(props, "RIFEFlowWidth", 0, &errWidth) };
+    auto flowHeight{ vsapi->mapGetIntSaturated(props, "RIFEFlowHeight", 0, &errHeight) };
+    auto scale{ vsapi->mapGetIntSaturated(props, "RIFEFlowScale", 0, &errScale) };
+    auto size{ vsapi->mapNumElements(props, "RIFEFlow") };
+
+    if (errWidth || errHeight || errScale || scale < 1 || size < 1 ||
+        flowWidth != (width + scale - 1) / scale || flowHeight != (height + scale - 1) / scale || size != static_cast<int64_t>(flowWidth) * flowHeight * channels)
+        return {};
+
+    auto blocks{ vsapi->mapGetFloatArray(props, "RIFEFlow", nullptr) };
+    ncnn::Mat flow(width, height, channels);
+    for (auto q{ 0 }; q < flow.c; q++) {
+        auto src{ blocks + static_cast<size_t>(flowWidth) * flowHeight * q };
+        for (auto y{ 0 }; y < height; y++) {
+            auto row{ flow.channel(q).row(y) };
+            for (auto x{ 0 }; x < width; x++)
+                row[x] = static_cast<float>(src[y / scale * flowWidth + x / scale]);
+        }
+    }
+
+    return flow;
+}
+
+// Interpolates the outputs of a pair, with a flow from getFlowProps in place of flownet if not empty.
+// Returns -1 if the model failed, e.g. because the server went away.
+static int interpolate(const VSFrame* src0, const VSFrame* src1, VSFrame* const* dsts, const float* timesteps, const int count,
+                        const ncnn::Mat& flowIn, const RIFEData* const VS_RESTRICT d, const VSAPI* vsapi) noexcept {
     const auto width{ vsapi->getFrameWidth(src0, 0) };
     const auto height{ vsapi->getFrameHeight(src0, 0) };
     const auto stride{ vsapi->getStride(src0, 0) / d->vi.format.bytesPerSample };
@@ -63,36 +298,335 @@ static void filter(const VSFrame* src0, const VSFrame* src1, VSFrame* dst,
     auto src1R{ reinterpret_cast<const float*>(vsapi->getReadPtr(src1, 0)) };
     auto src1G{ reinterpret_cast<const float*>(vsapi->getReadPtr(src1, 1)) };
     auto src1B{ reinterpret_cast<const float*>(vsapi->getReadPtr(src1, 2)) };
-    auto dstR{ reinterpret_cast<float*>(vsapi->getWritePtr(dst, 0)) };
-    auto dstG{ reinterpret_cast<float*>(vsapi->getWritePtr(dst, 1)) };
-    auto dstB{ reinterpret_cast<float*>(vsapi->getWritePtr(dst, 2)) };
 
-    d->semaphore->acquire();
-    d->rife->process(src0R, src0G, src0B, src1R, src1G, src1B, dstR, dstG, dstB, width, height, stride, timestep);
-    d->semaphore->release();
+    std::vector<float*> dstR(count);
+    std::vector<float*> dstG(count);
+    std::vector<float*> dstB(count);
+    for (auto i{ 0 }; i < count; i++) {
+        dstR[i] = reinterpret_cast<float*>(vsapi->getWritePtr(dsts[i], 0));
+        dstG[i] = reinterpret_cast<float*>(vsapi->getWritePtr(dsts[i], 1));
+        dstB[i] = reinterpret_cast<float*>(vsapi->getWritePtr(dsts[i], 2));
+    }
+
+    auto area{ d->borders == 1 ? d->activeArea : RIFERect{ 0, 0, width, height } };
+    if (d->borders == 2) {
+        auto area0{ rife_detect_active_area(src0R, src0G, src0B, width, height, stride, d->borderThreshold) };
+        auto area1{ rife_detect_active_area(src1R, src1G, src1B, width, height, stride, d->borderThreshold) };
+        area = rife_align_area(rife_union_area(area0, area1), width, height, d->granularity);
+    }
+
+    if (area.w != width || area.h != height) {
+        // the bars come from the nearer frame, only the active picture is interpolated
+        for (auto i{ 0 }; i < count; i++) {
+            auto bars{ timesteps[i] < 0.5f ? src0 : src1 };
+            for (auto plane{ 0 }; plane < 3; plane++)
+                vsh::bitblt(vsapi->getWritePtr(dsts[i], plane), vsapi->getStride(dsts[i], plane), vsapi->getReadPtr(bars, plane), vsapi->getStride(bars, plane),
+                            width * sizeof(float), height);
+        }
+
+        if (area.empty())
+            return 0;
+
+        auto offset{ area.y * stride + area.x };
+        src0R += offset;
+        src0G += offset;
+        src0B += offset;
+        src1R += offset;
+        src1G += offset;
+        src1B += offset;
+        for (auto i{ 0 }; i < count; i++) {
+            dstR[i] += offset;
+            dstG[i] += offset;
+            dstB[i] += offset;
+        }
+    }
+
+    std::vector<RIFERect> regions{ { 0, 0, area.w, area.h } };
+
+    if (d->roi) {
+        auto changed{ rife_changed_regions(src0R, src0G, src0B, src1R, src1G, src1B, area.w, area.h, stride,
+                                           d->roiThreshold, d->roiHalo, d->granularity) };
+
+        if (changed.size() != 1 || changed[0].w != area.w || changed[0].h != area.h) {
+            // static blocks are taken from src0, only the regions that changed are interpolated
+            const float* srcs[]{ src0R, src0G, src0B };
+            for (auto i{ 0 }; i < count; i++) {
+                float* planes[]{ dstR[i], dstG[i], dstB[i] };
+                for (auto plane{ 0 }; plane < 3; plane++)
+                    vsh::bitblt(planes[plane], stride * sizeof(float), srcs[plane], stride * sizeof(float), area.w * sizeof(float), area.h);
+            }
+
+            regions = std::move(changed);
+        }
+    }
+
+    // the flow of the whole frame, still where nothing was interpolated
+    ncnn::Mat flow;
+    auto ret{ 0 };
+
+    auto slot{ d->scheduler->acquire(d->stream, area.w, area.h) };
+    for (auto& region : regions) {
+        auto offset{ region.y * stride + region.x };
+        std::vector<float*> regionR(count);
+        std::vector<float*> regionG(count);
+        std::vector<float*> regionB(count);
+        for (auto i{ 0 }; i < count; i++) {
+            regionR[i] = dstR[i] + offset;
+            regionG[i] = dstG[i] + offset;
+            regionB[i] = dstB[i] + offset;
+        }
+
+        ncnn::Mat regionFlowIn;
+        if (!flowIn.empty()) {
+            regionFlowIn.create(region.w, region.h, flowIn.c);
+            for (auto q{ 0 }; q < flowIn.c; q++) {
+                for (auto y{ 0 }; y < region.h; y++)
+                    std::copy_n(flowIn.channel(q).row(area.y + region.y + y) + area.x + region.x, region.w, regionFlowIn.channel(q).row(y));
+            }
+        }
+
+#ifndef _WIN32
+        if (d->client) {
+            // the flow is neither sent to nor returned by the server
+            ret |= d->client->process_multi(d->clientStream, src0R + offset, src0G + offset, src0B + offset, src1R + offset, src1G + offset, src1B + offset,
+                                            regionR.data(), regionG.data(), regionB.data(), timesteps, count, region.w, region.h, stride);
+            continue;
+        }
+#endif
+
+        ncnn::Mat regionFlow;
+        ret |= d->rife->process_multi(src0R + offset, src0G + offset, src0B + offset, src1R + offset, src1G + offset, src1B + offset,
+                                      regionR.data(), regionG.data(), regionB.data(), timesteps, count, region.w, region.h, stride,
+                                      d->exportFlow ? &regionFlow : nullptr, flowIn.empty() ? nullptr : &regionFlowIn);
+
+        if (!regionFlow.empty()) {
+            if (flow.empty()) {
+                flow.create(width, height, regionFlow.c);
+                flow.fill(0.0f);
+            }
+
+            for (auto q{ 0 }; q < regionFlow.c; q++) {
+                for (auto y{ 0 }; y < region.h; y++)
+                    std::copy_n(regionFlow.channel(q).row(y), region.w, flow.channel(q).row(area.y + region.y + y) + area.x + region.x);
+            }
+        }
+    }
+    d->scheduler->release(slot);
+
+    if (!flow.empty())
+        setFlowProps(flow, dsts, count, d, vsapi);
+
+    return ret;
+}
+
+// Takes the outputs of a pair the disk cache has from it and interpolates the others, which are added.
+static int filter(const VSFrame* src0, const VSFrame* src1, VSFrame* const* dsts, const float* timesteps, const int count,
+                  const ncnn::Mat& flowIn, const RIFEData* const VS_RESTRICT d, const VSAPI* vsapi) noexcept {
+    if (!d->frameCache)
+        return interpolate(src0, src1, dsts, timesteps, count, flowIn, d, vsapi);
+
+    const auto width{ vsapi->getFrameWidth(src0, 0) };
+    const auto height{ vsapi->getFrameHeight(src0, 0) };
+    const auto stride{ vsapi->getStride(src0, 0) / d->vi.format.bytesPerSample };
+    auto planes{ [vsapi](const VSFrame* frame, int plane) { return reinterpret_cast<const float*>(vsapi->getReadPtr(frame, plane)); } };
+
+    // the key covers the pixels of both frames, an imported flow and the timestep on top of the settings
+    auto seed{ d->cacheSeed };
+    for (auto q{ 0 }; q < flowIn.c; q++)
+        seed = rife_hash(flowIn.channel(q).data, static_cast<size_t>(flowIn.w) * flowIn.h * sizeof(float), seed);
+
+    auto hash0{ rife_hash_planes(planes(src0, 0), planes(src0, 1), planes(src0, 2), width, height, stride, seed) };
+    auto hash1{ rife_hash_planes(planes(src1, 0), planes(src1, 1), planes(src1, 2), width, height, stride, seed) };
+
+    std::vector<VSFrame*> missing;
+    std::vector<float> missingTimesteps;
+    std::vector<std::string> missingKeys;
+    for (auto i{ 0 }; i < count; i++) {
+        char key[49];
+        snprintf(key, sizeof(key), "%016llx%016llx%016llx", static_cast<unsigned long long>(hash0), static_cast<unsigned long long>(hash1),
+                 static_cast<unsigned long long>(rife_hash(&timesteps[i], sizeof(float), seed)));
+
+        if (d->frameCache->load(key, reinterpret_cast<float*>(vsapi->getWritePtr(dsts[i], 0)), reinterpret_cast<float*>(vsapi->getWritePtr(dsts[i], 1)),
+                                reinterpret_cast<float*>(vsapi->getWritePtr(dsts[i], 2)), width, height, stride)) {
+            missing.push_back(dsts[i]);
+            missingTimesteps.push_back(timesteps[i]);
+            missingKeys.push_back(key);
+        }
+    }
+
+    if (missing.empty())
+        return 0;
+
+    if (interpolate(src0, src1, missing.data(), missingTimesteps.data(), static_cast<int>(missing.size()), flowIn, d, vsapi))
+        return -1;
+
+    for (size_t i{ 0 }; i < missing.size(); i++)
+        d->frameCache->save(missingKeys[i], planes(missing[i], 0), planes(missing[i], 1), planes(missing[i], 2), width, height, stride);
+
+    return 0;
+}
+
+// Source frame of output n and the timestep towards the next source frame, a timestep of 0 copies it.
+static std::pair<int, float> locateOutput(int n, const RIFEData* const VS_RESTRICT d) noexcept {
+    if (!d->retime.empty())
+        return { d->retime[n].frame, d->retime[n].timestep };
+
+    auto frameNum{ static_cast<int>(n * d->factorDen / d->factorNum) };
+    auto remainder{ n * d->factorDen % d->factorNum };
+    if (n >= d->vi.numFrames - d->factor)
+        remainder = 0;
+
+    return { frameNum, static_cast<float>(remainder) / d->factorNum };
+}
+
+// Hands out output n of the pair starting at source frame frameNum, interpolating all outputs of the
+// pair at once if it is the first one requested. Returns nullptr if they could not be interpolated.
+static VSFrame* interpolatePair(int n, int frameNum, const VSFrame* src0, const VSFrame* src1, const ncnn::Mat& flowIn,
+                                const RIFEData* const VS_RESTRICT d, VSCore* core, const VSAPI* vsapi) noexcept {
+    // outputs left unrequested, e.g. by a later SelectEvery, are dropped with the least recently used pairs
+    static constexpr size_t maxPairs{ 4 };
+
+    std::shared_ptr<PairOutputs> pair;
+    {
+        std::lock_guard lock{ d->pairsMutex };
+        auto it{ std::find_if(d->pairs.begin(), d->pairs.end(), [frameNum](const auto& p) { return p.first == frameNum; }) };
+        if (it != d->pairs.end()) {
+            d->pairs.splice(d->pairs.begin(), d->pairs, it);
+        } else {
+            d->pairs.emplace_front(frameNum, std::make_shared<PairOutputs>(vsapi));
+            if (d->pairs.size() > maxPairs)
+                d->pairs.pop_back();
+        }
+        pair = d->pairs.front().second;
+    }
+
+    std::lock_guard lock{ pair->mutex };
+
+    if (!pair->done) {
+        // the interpolated outputs of a pair are consecutive
+        auto inPair{ [d, frameNum](int i) {
+            auto [frame, timestep]{ locateOutput(i, d) };
+            return frame == frameNum && timestep > 0.0f;
+        } };
+
+        auto first{ n };
+        while (first > 0 && inPair(first - 1))
+            first--;
+
+        auto last{ n + 1 };
+        while (last < d->vi.numFrames && inPair(last))
+            last++;
+
+        std::vector<VSFrame*> dsts;
+        std::vector<float> timesteps;
+        pair->first = first;
+
+        for (auto i{ first }; i < last; i++) {
+            auto dst{ vsapi->newVideoFrame(&d->vi.format, vsapi->getFrameWidth(src0, 0), vsapi->getFrameHeight(src0, 0), src0, core) };
+            dsts.push_back(dst);
+            timesteps.push_back(locateOutput(i, d).second);
+        }
+        pair->frames.assign(dsts.begin(), dsts.end());
+
+        // the next request of the pair tries again
+        if (filter(src0, src1, dsts.data(), timesteps.data(), static_cast<int>(dsts.size()), flowIn, d, vsapi)) {
+            for (auto frame : pair->frames)
+                vsapi->freeFrame(frame);
+            pair->frames.clear();
+            return nullptr;
+        }
+
+        pair->pending = static_cast<int>(dsts.size());
+        pair->done = true;
+    }
+
+    auto dst{ vsapi->copyFrame(pair->frames[n - pair->first], core) };
+
+    if (--pair->pending == 0) {
+        std::lock_guard lock{ d->pairsMutex };
+        d->pairs.remove_if([&pair](const auto& p) { return p.second == pair; });
+    }
+
+    return dst;
+}
+
+// A reference to output n if it was interpolated recently, with the hit and miss counts so far.
+static const VSFrame* findOutput(int n, const RIFEData* const VS_RESTRICT d, VSCore* core, const VSAPI* vsapi) noexcept {
+    std::lock_guard lock{ d->outputsMutex };
+
+    auto it{ std::find_if(d->outputs.begin(), d->outputs.end(), [n](const auto& output) { return output.first == n; }) };
+    if (it == d->outputs.end()) {
+        d->outputsMisses++;
+        return nullptr;
+    }
+
+    d->outputs.splice(d->outputs.begin(), d->outputs, it);
+    d->outputsHits++;
+
+    auto dst{ vsapi->copyFrame(it->second, core) };
+    auto props{ vsapi->getFramePropertiesRW(dst) };
+    vsapi->mapSetInt(props, "RIFECacheHits", d->outputsHits, maReplace);
+    vsapi->mapSetInt(props, "RIFECacheMisses", d->outputsMisses, maReplace);
+    return dst;
+}
+
+// Keeps output n, dropping the least recently used outputs past the memory budget.
+static void addOutput(int n, VSFrame* dst, const RIFEData* const VS_RESTRICT d, const VSAPI* vsapi) noexcept {
+    auto size{ static_cast<size_t>(vsapi->getFrameWidth(dst, 0)) * vsapi->getFrameHeight(dst, 0) * 3 * sizeof(float) };
+    if (size > d->outputsBudget)
+        return;
+
+    std::lock_guard lock{ d->outputsMutex };
+
+    auto props{ vsapi->getFramePropertiesRW(dst) };
+    vsapi->mapSetInt(props, "RIFECacheHits", d->outputsHits, maReplace);
+    vsapi->mapSetInt(props, "RIFECacheMisses", d->outputsMisses, maReplace);
+
+    // another request for the same frame may have finished first
+    if (std::any_of(d->outputs.begin(), d->outputs.end(), [n](const auto& output) { return output.first == n; }))
+        return;
+
+    d->outputs.emplace_front(n, vsapi->addFrameRef(dst));
+    d->outputsSize += size;
+
+    while (d->outputsSize > d->outputsBudget) {
+        auto frame{ d->outputs.back().second };
+        d->outputsSize -= static_cast<size_t>(vsapi->getFrameWidth(frame, 0)) * vsapi->getFrameHeight(frame, 0) * 3 * sizeof(float);
+        vsapi->freeFrame(frame);
+        d->outputs.pop_back();
+    }
 }
 
 static const VSFrame* VS_CC rifeGetFrame(int n, int activationReason, void* instanceData, [[maybe_unused]] void** frameData,
                                          VSFrameContext* frameCtx, VSCore* core, const VSAPI* vsapi) {
     auto d{ static_cast<const RIFEData*>(instanceData) };
 
-    auto frameNum{ static_cast<int>(n * d->factorDen / d->factorNum) };
-    auto remainder{ n * d->factorDen % d->factorNum };
+    auto [frameNum, timestep]{ locateOutput(n, d) };
 
     if (activationReason == arInitial) {
+        // scrubbing back over outputs interpolated recently needs neither the source frames nor the GPU
+        if (timestep > 0.0f && d->outputsBudget) {
+            if (auto dst{ findOutput(n, d, core, vsapi) })
+                return dst;
+        }
+
         vsapi->requestFrameFilter(frameNum, d->node, frameCtx);
-        if (remainder != 0 && n < d->vi.numFrames - d->factor)
+        if (timestep > 0.0f)
             vsapi->requestFrameFilter(frameNum + 1, d->node, frameCtx);
 
         if (d->skip)
             vsapi->requestFrameFilter(frameNum, d->psnr, frameCtx);
+
+        if (d->flow && timestep > 0.0f)
+            vsapi->requestFrameFilter(n, d->flow, frameCtx);
     } else if (activationReason == arAllFramesReady) {
         auto src0{ vsapi->getFrameFilter(frameNum, d->node, frameCtx) };
         decltype(src0) src1{};
         decltype(src0) psnr{};
         VSFrame* dst{};
+        bool interpolated{};
 
-        if (remainder != 0 && n < d->vi.numFrames - d->factor) {
+        if (timestep > 0.0f) {
             bool sceneChange{};
             double psnrY{ -1.0 };
             int err;
@@ -109,23 +643,77 @@ static const VSFrame* VS_CC rifeGetFrame(int n, int activationReason, void* inst
                 dst = vsapi->copyFrame(src0, core);
             } else {
                 src1 = vsapi->getFrameFilter(frameNum + 1, d->node, frameCtx);
-                dst = vsapi->newVideoFrame(&d->vi.format, d->vi.width, d->vi.height, src0, core);
-                filter(src0, src1, dst, static_cast<float>(remainder) / d->factorNum, d, vsapi);
+
+                auto width{ vsapi->getFrameWidth(src0, 0) };
+                auto height{ vsapi->getFrameHeight(src0, 0) };
+
+                // frames without an earlier flow run flownet
+                ncnn::Mat flowIn;
+                if (d->flow) {
+                    auto flowFrame{ vsapi->getFrameFilter(n, d->flow, frameCtx) };
+                    flowIn = getFlowProps(flowFrame, width, height, d->flowChannels, vsapi);
+                    vsapi->freeFrame(flowFrame);
+                }
+
+                // there is no flow between frames of different sizes, a pair across a resolution change repeats the first
+                if (vsapi->getFrameWidth(src1, 0) != width || vsapi->getFrameHeight(src1, 0) != height) {
+                    dst = vsapi->copyFrame(src0, core);
+                } else if (d->sharePairs) {
+                    dst = interpolatePair(n, frameNum, src0, src1, flowIn, d, core, vsapi);
+                    interpolated = true;
+                } else {
+                    dst = vsapi->newVideoFrame(&d->vi.format, width, height, src0, core);
+                    if (filter(src0, src1, &dst, &timestep, 1, flowIn, d, vsapi)) {
+                        vsapi->freeFrame(dst);
+                        dst = nullptr;
+                    }
+                    interpolated = true;
+                }
             }
         } else {
             dst = vsapi->copyFrame(src0, core);
         }
 
+        if (!dst) {
+            vsapi->setFilterError(("RIFE: failed to interpolate frame " + std::to_string(n)).c_str(), frameCtx);
+            vsapi->freeFrame(src0);
+            vsapi->freeFrame(src1);
+            vsapi->freeFrame(psnr);
+            return nullptr;
+        }
+
         auto props{ vsapi->getFramePropertiesRW(dst) };
-        int errNum, errDen;
-        auto durationNum{ vsapi->mapGetInt(props, "_DurationNum", 0, &errNum) };
-        auto durationDen{ vsapi->mapGetInt(props, "_DurationDen", 0, &errDen) };
-        if (!errNum && !errDen) {
-            vsh::muldivRational(&durationNum, &durationDen, d->factorDen, d->factorNum);
-            vsapi->mapSetInt(props, "_DurationNum", durationNum, maReplace);
-            vsapi->mapSetInt(props, "_DurationDen", durationDen, maReplace);
+        if (!d->times.empty()) {
+            // the target timeline decides the timing, frames of a list last until the next one
+            int64_t durationNum{ d->vi.fpsDen };
+            int64_t durationDen{ d->vi.fpsNum };
+            if (!d->vi.fpsNum && d->times.size() > 1) {
+                auto next{ static_cast<size_t>(n) + 1 < d->times.size() ? n + 1 : n };
+                durationNum = std::llround((d->times[next] - d->times[next - 1]) * 1000000);
+                durationDen = 1000000;
+                vsh::reduceRational(&durationNum, &durationDen);
+            }
+
+            if (durationNum > 0 && durationDen > 0) {
+                vsapi->mapSetInt(props, "_DurationNum", durationNum, maReplace);
+                vsapi->mapSetInt(props, "_DurationDen", durationDen, maReplace);
+            }
+            vsapi->mapSetFloat(props, "_AbsoluteTime", d->times[n], maReplace);
+        } else {
+            int errNum, errDen;
+            auto durationNum{ vsapi->mapGetInt(props, "_DurationNum", 0, &errNum) };
+            auto durationDen{ vsapi->mapGetInt(props, "_DurationDen", 0, &errDen) };
+            if (!errNum && !errDen) {
+                vsh::muldivRational(&durationNum, &durationDen, d->factorDen, d->factorNum);
+                vsapi->mapSetInt(props, "_DurationNum", durationNum, maReplace);
+                vsapi->mapSetInt(props, "_DurationDen", durationDen, maReplace);
+            }
         }
 
+        // kept once its properties are final, the cache shares the frame
+        if (interpolated && d->outputsBudget)
+            addOutput(n, dst, d, vsapi);
+
         vsapi->freeFrame(src0);
         vsapi->freeFrame(src1);
         vsapi->freeFrame(psnr);
@@ -135,33 +723,52 @@ static const VSFrame* VS_CC rifeGetFrame(int n, int activationReason, void* inst
     return nullptr;
 }
 
-static void VS_CC rifeFree(void* instanceData, [[maybe_unused]] VSCore* core, const VSAPI* vsapi) {
+static void VS_CC rifeFree(void* instanceData, VSCore* core, const VSAPI* vsapi) {
     auto d{ static_cast<RIFEData*>(instanceData) };
+
+    if (d->outputsBudget) {
+        vsapi->logMessage(mtInformation, ("RIFE: output cache hits: " + std::to_string(d->outputsHits) +
+                                          ", misses: " + std::to_string(d->outputsMisses)).c_str(), core);
+
+        for (auto& output : d->outputs)
+            vsapi->freeFrame(output.second);
+    }
+
     vsapi->freeNode(d->node);
     vsapi->freeNode(d->psnr);
+    vsapi->freeNode(d->flow);
     delete d;
-
-    if (--numGPUInstances == 0)
-        ncnn::destroy_gpu_instance();
 }
 
-static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void* userData, VSCore* core, const VSAPI* vsapi) {
+// Creates the filter of one clip and appends it to out, or sets the error. The model and the scheduler of
+// the GPU, or the connection to the server, are set up by the first clip and shared by the others.
+static void createOutput(const VSMap* in, VSNode* node, VSMap* out, std::shared_ptr<RIFE>& rife, std::shared_ptr<RIFEScheduler>& scheduler,
+                         std::shared_ptr<RIFEClient>& client, VSCore* core, const VSAPI* vsapi) {
     auto d{ std::make_unique<RIFEData>() };
+    std::string serverError;
 
     try {
-        d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+        d->node = node;
         d->vi = *vsapi->getVideoInfo(d->node);
         int err;
 
-        if (!vsh::isConstantVideoFormat(&d->vi) ||
-            d->vi.format.colorFamily != cfRGB ||
+        // the resolution may vary, every size gets its own specialized pipelines when it is first interpolated
+        if (d->vi.format.colorFamily != cfRGB ||
             d->vi.format.sampleType != stFloat ||
             d->vi.format.bitsPerSample != 32)
             throw "only constant RGB format 32 bit float input supported";
 
-        if (ncnn::create_gpu_instance())
+        auto variableSize{ !d->vi.width || !d->vi.height };
+
+        auto idleTimeout{ vsapi->mapGetFloat(in, "idle_timeout", 0, &err) };
+        if (err)
+            idleTimeout = -1.0;
+
+        // a client leaves the GPU to the server
+        auto server{ vsapi->mapGetData(in, "server", 0, &err) };
+
+        if (!server && !d->gpuInstance.acquire(idleTimeout))
             throw "failed to create GPU instance";
-        ++numGPUInstances;
 
         auto model{ vsapi->mapGetIntSaturated(in, "model", 0, &err) };
         if (err)
@@ -183,11 +790,15 @@ static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void*
         if (!err && fpsDen < 1)
             throw "fps_den must be at least 1";
 
+        auto timecodes{ vsapi->mapGetData(in, "timecodes", 0, &err) };
+        auto numFrameTimes{ vsapi->mapNumElements(in, "frame_times") };
+        auto retime{ timecodes || numFrameTimes > 0 };
+
         auto model_path{ vsapi->mapGetData(in, "model_path", 0, &err) };
         std::string modelPath{ err ? "" : model_path };
 
         auto gpuId{ vsapi->mapGetIntSaturated(in, "gpu_id", 0, &err) };
-        if (err)
+        if (err && !server)
             gpuId = ncnn::get_default_gpu_index();
 
         auto gpuThread{ vsapi->mapGetIntSaturated(in, "gpu_thread", 0, &err) };
@@ -203,6 +814,43 @@ static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void*
         if (err)
             d->skipThreshold = 60.0;
 
+        d->borders = vsapi->mapGetIntSaturated(in, "borders", 0, &err);
+
+        d->borderThreshold = vsapi->mapGetFloatSaturated(in, "border_threshold", 0, &err);
+        if (err)
+            d->borderThreshold = 0.04f;
+
+        d->roi = !!vsapi->mapGetInt(in, "roi", 0, &err);
+
+        d->roiThreshold = vsapi->mapGetFloatSaturated(in, "roi_threshold", 0, &err);
+        if (err)
+            d->roiThreshold = 0.01f;
+
+        d->roiHalo = vsapi->mapGetIntSaturated(in, "roi_halo", 0, &err);
+        if (err)
+            d->roiHalo = 64;
+
+        auto cacheMB{ vsapi->mapGetInt(in, "cache_mb", 0, &err) };
+
+        auto cache_dir{ vsapi->mapGetData(in, "cache_dir", 0, &err) };
+        auto cacheFp16{ !!vsapi->mapGetInt(in, "cache_fp16", 0, &err) };
+
+        d->flow = vsapi->mapGetNode(in, "flow", 0, &err);
+        d->exportFlow = !!vsapi->mapGetInt(in, "export_flow", 0, &err);
+
+        d->flowScale = vsapi->mapGetIntSaturated(in, "flow_scale", 0, &err);
+        if (err)
+            d->flowScale = 1;
+
+        auto warmup{ vsapi->mapGetIntSaturated(in, "warmup", 0, &err) };
+
+        auto optimize{ !!vsapi->mapGetInt(in, "optimize", 0, &err) };
+
+        auto autotune{ !!vsapi->mapGetInt(in, "autotune", 0, &err) };
+
+        auto tuning_dir{ vsapi->mapGetData(in, "tuning_dir", 0, &err) };
+        auto tuningDir{ err ? rife_tuning_default_dir() : std::filesystem::path{ reinterpret_cast<const char8_t*>(tuning_dir) } };
+
         if (model < 0 || model > 9)
             throw "model must be between 0 and 9 (inclusive)";
 
@@ -212,40 +860,142 @@ static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void*
         if (factorDen < 1)
             throw "factor_den must be at least 1";
 
-        if (fpsNum && fpsDen && !(d->vi.fpsNum && d->vi.fpsDen))
+        if (fpsNum && fpsDen && !retime && !(d->vi.fpsNum && d->vi.fpsDen))
             throw "clip does not have a valid frame rate and hence fps_num and fps_den cannot be used";
 
-        if (gpuId < 0 || gpuId >= ncnn::get_gpu_count())
+        if (!server && (gpuId < 0 || gpuId >= ncnn::get_gpu_count()))
             throw "invalid GPU device";
 
-        if (auto queueCount{ ncnn::get_gpu_info(gpuId).compute_queue_count() }; gpuThread < 1 || static_cast<uint32_t>(gpuThread) > queueCount)
+        // with a server it is the number of jobs in flight, the server decides how many of all clients run at once
+        if (server) {
+            if (gpuThread < 1)
+                throw "gpu_thread must be at least 1";
+        } else if (auto queueCount{ ncnn::get_gpu_info(gpuId).compute_queue_count() }; gpuThread < 1 || static_cast<uint32_t>(gpuThread) > queueCount) {
             throw ("gpu_thread must be between 1 and " + std::to_string(queueCount) + " (inclusive)").c_str();
+        }
 
         if (d->skipThreshold < 0 || d->skipThreshold > 60)
             throw "skip_threshold must be between 0.0 and 60.0 (inclusive)";
 
-        if (fpsNum && fpsDen) {
-            vsh::muldivRational(&fpsNum, &fpsDen, d->vi.fpsDen, d->vi.fpsNum);
-            d->factorNum = fpsNum;
-            d->factorDen = fpsDen;
-        } else {
-            d->factorNum = factorNum;
-            d->factorDen = factorDen;
-        }
-        vsh::muldivRational(&d->vi.fpsNum, &d->vi.fpsDen, d->factorNum, d->factorDen);
+        if (d->borders < 0 || d->borders > 2)
+            throw "borders must be 0, 1 or 2";
+
+        if (d->borderThreshold < 0.0f || d->borderThreshold >= 1.0f)
+            throw "border_threshold must be between 0.0 and 1.0";
+
+        if (d->roiThreshold < 0.0f || d->roiThreshold >= 1.0f)
+            throw "roi_threshold must be between 0.0 and 1.0";
+
+        if (d->roiHalo < 0)
+            throw "roi_halo must be at least 0";
+
+        if (d->flowScale < 1)
+            throw "flow_scale must be at least 1";
+
+        if (cacheMB < 0)
+            throw "cache_mb must be at least 0";
+
+        d->outputsBudget = static_cast<size_t>(cacheMB) << 20;
+
+        if (warmup < 0)
+            throw "warmup must be at least 0";
+
+        if (variableSize && d->skip)
+            throw "skip requires a clip with constant resolution";
+
+        if (variableSize && d->borders == 1)
+            throw "borders=1 requires a clip with constant resolution, use borders=2";
+
+        if (variableSize && (warmup || autotune))
+            throw "warmup and autotune require a clip with constant resolution";
 
         if (d->vi.numFrames < 2)
             throw "clip's number of frames must be at least 2";
 
-        if (d->vi.numFrames / d->factorDen > INT_MAX / d->factorNum)
-            throw "resulting clip is too long";
-
         auto oldNumFrames{ d->vi.numFrames };
-        d->vi.numFrames = static_cast<int>(d->vi.numFrames * d->factorNum / d->factorDen);
 
-        d->factor = d->factorNum / d->factorDen;
+        if (retime) {
+            // timecodes are rounded to milliseconds, a target time within half of one of a source frame copies it
+            static constexpr auto tolerance{ 0.0005 };
+
+            std::vector<double> sourceTimes;
+            double end;
+
+            if (timecodes) {
+                if (rife_read_timecodes(std::filesystem::path{ reinterpret_cast<const char8_t*>(timecodes) }, sourceTimes))
+                    throw "failed to read timecodes";
+
+                if (sourceTimes.size() < static_cast<size_t>(d->vi.numFrames))
+                    throw "timecodes has fewer times than the clip has frames";
+
+                // a time past the last frame is its end, otherwise the last frame lasts as long as the one before
+                end = sourceTimes.size() > static_cast<size_t>(d->vi.numFrames) ? sourceTimes[d->vi.numFrames]
+                                                                                 : 2 * sourceTimes[d->vi.numFrames - 1] - sourceTimes[d->vi.numFrames - 2];
+                sourceTimes.resize(d->vi.numFrames);
+            } else {
+                if (!d->vi.fpsNum || !d->vi.fpsDen)
+                    throw "clip does not have a valid frame rate and hence frame_times requires timecodes";
+
+                for (auto i{ 0 }; i <= d->vi.numFrames; i++)
+                    sourceTimes.push_back(static_cast<double>(i) * d->vi.fpsDen / d->vi.fpsNum);
+                end = sourceTimes.back();
+                sourceTimes.pop_back();
+            }
+
+            if (numFrameTimes > 0) {
+                auto frameTimes{ vsapi->mapGetFloatArray(in, "frame_times", nullptr) };
+                d->times.assign(frameTimes, frameTimes + numFrameTimes);
+
+                if (std::adjacent_find(d->times.begin(), d->times.end(), std::greater_equal{}) != d->times.end())
+                    throw "frame_times must be increasing";
+
+                // a list of times has no frame rate, every frame carries its own duration
+                d->vi.fpsNum = 0;
+                d->vi.fpsDen = 0;
+            } else {
+                if (!fpsNum || !fpsDen)
+                    throw "timecodes requires fps_num and fps_den, or frame_times";
+
+                vsh::reduceRational(&fpsNum, &fpsDen);
+
+                if ((end - sourceTimes[0]) * fpsNum / fpsDen >= INT_MAX)
+                    throw "resulting clip is too long";
+
+                for (int64_t i{ 0 };; i++) {
+                    auto time{ sourceTimes[0] + static_cast<double>(i) * fpsDen / fpsNum };
+                    if (time >= end - tolerance)
+                        break;
+                    d->times.push_back(time);
+                }
+
+                d->vi.fpsNum = fpsNum;
+                d->vi.fpsDen = fpsDen;
+            }
+
+            d->retime = rife_retime(sourceTimes, d->times, tolerance);
+            d->vi.numFrames = static_cast<int>(d->times.size());
+        } else {
+            if (fpsNum && fpsDen) {
+                vsh::muldivRational(&fpsNum, &fpsDen, d->vi.fpsDen, d->vi.fpsNum);
+                d->factorNum = fpsNum;
+                d->factorDen = fpsDen;
+            } else {
+                d->factorNum = factorNum;
+                d->factorDen = factorDen;
+            }
+            vsh::muldivRational(&d->vi.fpsNum, &d->vi.fpsDen, d->factorNum, d->factorDen);
+
+            if (d->vi.numFrames / d->factorDen > INT_MAX / d->factorNum)
+                throw "resulting clip is too long";
+
+            d->vi.numFrames = static_cast<int>(d->vi.numFrames * d->factorNum / d->factorDen);
+
+            d->factor = d->factorNum / d->factorDen;
+        }
 
         if (!!vsapi->mapGetInt(in, "list_gpu", 0, &err)) {
+            vsapi->freeNode(d->flow);
+
             std::string text;
 
             for (auto i{ 0 }; i < ncnn::get_gpu_count(); i++)
@@ -260,83 +1010,169 @@ static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void*
                 vsapi->mapSetError(out, vsapi->mapGetError(ret));
                 vsapi->freeMap(args);
                 vsapi->freeMap(ret);
-
-                if (--numGPUInstances == 0)
-                    ncnn::destroy_gpu_instance();
                 return;
             }
 
-            vsapi->mapConsumeNode(out, "clip", vsapi->mapGetNode(ret, "clip", 0, nullptr), maReplace);
+            vsapi->mapConsumeNode(out, "clip", vsapi->mapGetNode(ret, "clip", 0, nullptr), maAppend);
             vsapi->freeMap(args);
             vsapi->freeMap(ret);
-
-            if (--numGPUInstances == 0)
-                ncnn::destroy_gpu_instance();
             return;
         }
 
+        bool embedded{};
+
         if (modelPath.empty()) {
-            std::string pluginPath{ vsapi->getPluginPath(vsapi->getPluginByID("com.holywu.rife", core)) };
-            modelPath = pluginPath.substr(0, pluginPath.rfind('/')) + "/models";
-
-            switch (model) {
-            case 0:
-                modelPath += "/rife";
-                break;
-            case 1:
-                modelPath += "/rife-HD";
-                break;
-            case 2:
-                modelPath += "/rife-UHD";
-                break;
-            case 3:
-                modelPath += "/rife-anime";
-                break;
-            case 4:
-                modelPath += "/rife-v2";
-                break;
-            case 5:
-                modelPath += "/rife-v2.3";
-                break;
-            case 6:
-                modelPath += "/rife-v2.4";
-                break;
-            case 7:
-                modelPath += "/rife-v3.0";
-                break;
-            case 8:
-                modelPath += "/rife-v3.1";
-                break;
-            case 9:
-                modelPath += "/rife-v4";
-                break;
+            static constexpr const char* modelNames[]{
+                "rife", "rife-HD", "rife-UHD", "rife-anime", "rife-v2", "rife-v2.3", "rife-v2.4", "rife-v3.0", "rife-v3.1", "rife-v4"
+            };
+
+#ifdef RIFE_EMBEDDED_MODELS
+            embedded = rife_find_embedded_net(modelNames[model], "flownet");
+#endif
+
+            if (embedded) {
+                modelPath = modelNames[model];
+            } else {
+                std::string pluginPath{ vsapi->getPluginPath(vsapi->getPluginByID("com.holywu.rife", core)) };
+                modelPath = pluginPath.substr(0, pluginPath.rfind('/')) + "/models/" + modelNames[model];
             }
         }
 
-        std::ifstream ifs{ modelPath + "/flownet.param" };
-        if (!ifs.is_open())
-            throw "failed to load model";
-        ifs.close();
+        if (!embedded) {
+            std::ifstream ifs{ modelPath + "/flownet.param" };
+            if (!ifs.is_open())
+                throw "failed to load model";
+        }
 
-        bool rife_v2{};
-        bool rife_v4{};
+        std::string manifest;
+#ifdef RIFE_EMBEDDED_MODELS
+        if (embedded) {
+            if (auto net{ rife_find_embedded_net(modelPath.c_str(), "model.json") })
+                manifest = net->param;
+        } else
+#endif
+        {
+            std::ifstream ifs{ modelPath + "/model.json", std::ios::binary };
+            if (ifs.is_open())
+                manifest.assign(std::istreambuf_iterator<char>{ ifs }, {});
+        }
 
-        if (modelPath.find("rife-v2") != std::string::npos)
-            rife_v2 = true;
-        else if (modelPath.find("rife-v3") != std::string::npos)
-            rife_v2 = true;
-        else if (modelPath.find("rife-v4") != std::string::npos)
-            rife_v4 = true;
-        else if (modelPath.find("rife") == std::string::npos)
-            throw "unknown model dir type";
+        RIFEModelInfo modelInfo;
+
+        if (!manifest.empty()) {
+            if (rife_model_parse(manifest.c_str(), modelInfo))
+                throw "failed to parse model.json";
+        } else {
+            // without a manifest the family is told by the directory name
+            if (rife_model_guess(modelPath, modelInfo))
+                throw "unknown model dir type";
+        }
 
-        if (!rife_v4 && (d->factorNum != 2 || d->factorDen != 1))
-            throw "only rife-v4 model supports custom frame rate";
+        // models without timestep bisect, the outputs of a pair share their midpoints
+        d->sharePairs = !modelInfo.timestep && (retime || d->factorNum != 2 || d->factorDen != 1);
 
-        if (rife_v4 && tta)
+        if (modelInfo.rife_v4 && tta)
             throw "rife-v4 model does not support TTA mode";
 
-        d->semaphore = std::make_unique<std::counting_semaphore<>>(gpuThread);
+        // v4 flownets blend the frame themselves, the flow never leaves the graph
+        if (modelInfo.rife_v4 && d->exportFlow)
+            throw "rife-v4 model does not support export_flow";
+
+        if (d->flow) {
+            if (modelInfo.rife_v4)
+                throw "rife-v4 model does not support flow";
+
+            // the augmented passes each estimate a flow of their own orientation
+            if (tta)
+                throw "flow does not support TTA mode";
+
+            if (vsapi->getVideoInfo(d->flow)->numFrames != d->vi.numFrames)
+                throw "flow must have as many frames as the output";
+
+            // a flow exported by a model of another family runs flownet instead
+            d->flowChannels = modelInfo.flow_channels();
+        }
+
+        if (server) {
+            // only the frames travel to the server and back
+            if (d->exportFlow || d->flow)
+                throw "export_flow and flow cannot be used with server";
+
+            // the server looks up the tuning files itself, it cannot benchmark while serving others
+            if (autotune)
+                throw "autotune cannot be used with server";
+        }
+
+        // UHD mode estimates the flow at half resolution, scripts passing uhd to every model keep working
+        if (uhd && !modelInfo.supports_scale(0.5f)) {
+            vsapi->logMessage(mtWarning, "RIFE: the model does not support UHD mode (no 0.5 scale), uhd is ignored", core);
+            uhd = false;
+        }
+
+        if (cache_dir) {
+            // entries hold the frames only, the flow would have to be cached along with them
+            if (d->exportFlow)
+                throw "cache_dir cannot be combined with export_flow";
+
+            // the optimized graphs differ from the shipped ones in the last bits
+            auto settings{ "rife 9|"s + modelPath + "|tta=" + std::to_string(tta) + "|uhd=" + std::to_string(uhd) +
+                           "|optimize=" + std::to_string(optimize) +
+                           "|borders=" + std::to_string(d->borders) + "," + std::to_string(d->borderThreshold) +
+                           "|roi=" + std::to_string(d->roi) + "," + std::to_string(d->roiThreshold) + "," + std::to_string(d->roiHalo) +
+                           "|" + manifest };
+            d->cacheSeed = rife_hash(settings.data(), settings.size(), 0);
+
+            // and the nets themselves, so replacing the files of a model dir does not serve frames of the old ones
+            for (auto net : { "flownet", "contextnet", "fusionnet" }) {
+#ifdef RIFE_EMBEDDED_MODELS
+                if (embedded) {
+                    if (auto embeddedNet{ rife_find_embedded_net(modelPath.c_str(), net) }) {
+                        d->cacheSeed = rife_hash(embeddedNet->param, strlen(embeddedNet->param), d->cacheSeed);
+                        d->cacheSeed = rife_hash(embeddedNet->bin, embeddedNet->bin_size, d->cacheSeed);
+                    }
+                    continue;
+                }
+#endif
+
+                for (auto extension : { ".param", ".bin" }) {
+                    MappedFile file;
+                    if (!file.open(std::filesystem::path{ modelPath + "/" + net + extension }))
+                        d->cacheSeed = rife_hash(file.data(), file.size(), d->cacheSeed);
+                }
+            }
+            d->frameCache = std::make_unique<RIFEFrameCache>(std::filesystem::path{ reinterpret_cast<const char8_t*>(cache_dir) }, cacheFp16);
+        }
+
+        d->activeArea = { 0, 0, d->vi.width, d->vi.height };
+        d->granularity = modelInfo.padding;
+
+        if (d->borders == 1) {
+            // the bars of the whole clip, from frames spread over it, the picture of any of them is kept
+            RIFERect area{};
+            auto samples{ std::min(oldNumFrames, 16) };
+
+            for (auto i{ 0 }; i < samples; i++) {
+                char errorMsg[1024];
+                auto frame{ vsapi->getFrame(static_cast<int>(static_cast<int64_t>(oldNumFrames - 1) * i / std::max(samples - 1, 1)), d->node, errorMsg, sizeof(errorMsg)) };
+                if (!frame)
+                    throw "failed to fetch a frame for border detection";
+
+                auto frameStride{ vsapi->getStride(frame, 0) / d->vi.format.bytesPerSample };
+                area = rife_union_area(area, rife_detect_active_area(reinterpret_cast<const float*>(vsapi->getReadPtr(frame, 0)),
+                                                                     reinterpret_cast<const float*>(vsapi->getReadPtr(frame, 1)),
+                                                                     reinterpret_cast<const float*>(vsapi->getReadPtr(frame, 2)),
+                                                                     d->vi.width, d->vi.height, frameStride, d->borderThreshold));
+                vsapi->freeFrame(frame);
+            }
+
+            if (!area.empty())
+                d->activeArea = rife_align_area(area, d->vi.width, d->vi.height, d->granularity);
+        }
+
+        if (!scheduler)
+            scheduler = std::make_shared<RIFEScheduler>(gpuThread);
+        d->scheduler = scheduler;
+        d->stream = scheduler->add_stream();
 
         if (d->skip) {
             auto vmaf{ vsapi->getPluginByID("com.holywu.vmaf", core) };
@@ -356,9 +1192,6 @@ static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void*
                 vsapi->mapSetError(out, vsapi->mapGetError(ret));
                 vsapi->freeMap(args);
                 vsapi->freeMap(ret);
-
-                if (--numGPUInstances == 0)
-                    ncnn::destroy_gpu_instance();
                 return;
             }
 
@@ -373,9 +1206,6 @@ static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void*
                 vsapi->mapSetError(out, vsapi->mapGetError(ret));
                 vsapi->freeMap(args);
                 vsapi->freeMap(ret);
-
-                if (--numGPUInstances == 0)
-                    ncnn::destroy_gpu_instance();
                 return;
             }
 
@@ -389,9 +1219,6 @@ static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void*
                 vsapi->mapSetError(out, vsapi->mapGetError(ret));
                 vsapi->freeMap(args);
                 vsapi->freeMap(ret);
-
-                if (--numGPUInstances == 0)
-                    ncnn::destroy_gpu_instance();
                 return;
             }
 
@@ -406,9 +1233,6 @@ static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void*
                 vsapi->mapSetError(out, vsapi->mapGetError(ret));
                 vsapi->freeMap(args);
                 vsapi->freeMap(ret);
-
-                if (--numGPUInstances == 0)
-                    ncnn::destroy_gpu_instance();
                 return;
             }
 
@@ -417,33 +1241,179 @@ static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void*
             vsapi->freeMap(ret);
         }
 
-        d->rife = std::make_unique<RIFE>(gpuId, tta, uhd, 1, rife_v2, rife_v4);
+        auto createRIFE{ [&](const RIFETuning& tuning) {
+            auto rife{ std::make_unique<RIFE>(gpuId, modelInfo, tta, uhd, 1, optimize) };
+            rife->set_tuning(tuning);
 
+#ifdef RIFE_EMBEDDED_MODELS
+            if (embedded) {
+                if (rife->load_embedded(modelPath))
+                    throw "failed to load model";
+            } else
+#endif
+            {
 #ifdef _WIN32
-        auto bufferSize{ MultiByteToWideChar(CP_UTF8, 0, modelPath.c_str(), -1, nullptr, 0) };
-        std::vector<wchar_t> wbuffer(bufferSize);
-        MultiByteToWideChar(CP_UTF8, 0, modelPath.c_str(), -1, wbuffer.data(), bufferSize);
-        d->rife->load(wbuffer.data());
+                auto bufferSize{ MultiByteToWideChar(CP_UTF8, 0, modelPath.c_str(), -1, nullptr, 0) };
+                std::vector<wchar_t> wbuffer(bufferSize);
+                MultiByteToWideChar(CP_UTF8, 0, modelPath.c_str(), -1, wbuffer.data(), bufferSize);
+                if (rife->load(wbuffer.data()))
+                    throw "failed to load model";
 #else
-        d->rife->load(modelPath);
+                if (rife->load(modelPath))
+                    throw "failed to load model";
 #endif
+            }
+
+            return rife;
+        } };
+
+        // settings tuned for this device, model and resolution by an earlier run are picked up even
+        // without autotune, a missing entry is tuned and stored when autotune is enabled
+        RIFETuning tuning;
+        std::filesystem::path tuningPath;
+        auto tuningKey{ rife_tuning_key(modelPath, d->activeArea.w, d->activeArea.h, tta, uhd, optimize) };
+
+        if (!tuningDir.empty() && !variableSize && !server)
+            tuningPath = rife_tuning_path(tuningDir, ncnn::get_gpu_info(gpuId));
+
+        if (server) {
+#ifdef _WIN32
+            throw "server is not supported on Windows";
+#else
+            // the first clip waits until the server has the model loaded, it stays loaded for the next jobs
+            if (!client) {
+                RIFEServerModel serverModel{ embedded ? modelPath : std::filesystem::absolute(modelPath).string(), embedded, manifest,
+                                             tta, uhd, optimize, d->activeArea.w, d->activeArea.h };
+                auto newClient{ std::make_shared<RIFEClient>(server, serverModel) };
+                if (newClient->open(serverError))
+                    throw serverError.c_str();
+                client = newClient;
+            }
+
+            d->client = client;
+            d->clientStream = client->add_stream();
+#endif
+        }
+
+        auto loaded{ !!rife || !!client };
+
+        if (!loaded && (tuningPath.empty() || rife_tuning_load(tuningPath, tuningKey, tuning)) && autotune) {
+            std::vector<float> src(static_cast<size_t>(d->activeArea.w) * d->activeArea.h);
+            std::vector<float> dst(src.size());
+
+            auto benchmark{ [&](const RIFETuning& candidate) {
+                try {
+                    auto rife{ createRIFE(candidate) };
+                    auto best{ -1.0 };
+
+                    // the first runs allocate and specialize the pipelines, the fastest of the rest counts
+                    for (auto i{ 0 }; i < 5; i++) {
+                        auto start{ std::chrono::steady_clock::now() };
+                        if (rife->process(src.data(), src.data(), src.data(), src.data(), src.data(), src.data(),
+                                          dst.data(), dst.data(), dst.data(), d->activeArea.w, d->activeArea.h, d->activeArea.w, 0.5f))
+                            return -1.0;
+                        std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - start };
+
+                        if (i > 1 && (best < 0 || elapsed.count() < best))
+                            best = elapsed.count();
+                    }
+
+                    return best;
+                } catch (const char*) {
+                    return -1.0;
+                }
+            } };
+
+            if (rife_autotune(ncnn::get_gpu_info(gpuId), benchmark, tuning))
+                throw "failed to autotune";
+
+            if (!tuningPath.empty())
+                rife_tuning_save(tuningPath, tuningKey, tuning);
+        }
+
+        if (!loaded)
+            rife = createRIFE(tuning);
+        d->rife = rife;
+
+        if (!loaded && warmup > 0) {
+            // run dummy inferences at the size frames are interpolated at on every concurrent slot so that allocator pools
+            // and lazily created driver state are in place before the first real frame is requested
+            std::vector<float> src(static_cast<size_t>(d->activeArea.w) * d->activeArea.h);
+            std::vector<std::thread> slots;
+            std::atomic<int> failed{ 0 };
+
+            for (auto i{ 0 }; i < gpuThread; i++) {
+                slots.emplace_back([&] {
+                    std::vector<float> dst(src.size());
+
+                    for (auto j{ 0 }; j < warmup && !failed; j++) {
+                        if (d->rife->process(src.data(), src.data(), src.data(), src.data(), src.data(), src.data(),
+                                             dst.data(), dst.data(), dst.data(), d->activeArea.w, d->activeArea.h, d->activeArea.w, 0.5f))
+                            failed++;
+                    }
+                });
+            }
+
+            for (auto& slot : slots)
+                slot.join();
+
+            if (failed)
+                throw "failed to warm up";
+        }
     } catch (const char* error) {
         vsapi->mapSetError(out, ("RIFE: "s + error).c_str());
         vsapi->freeNode(d->node);
         vsapi->freeNode(d->psnr);
-
-        if (--numGPUInstances == 0)
-            ncnn::destroy_gpu_instance();
+        vsapi->freeNode(d->flow);
         return;
     }
 
     std::vector<VSFilterDependency> deps{ {d->node, rpGeneral} };
     if (d->skip)
         deps.push_back({ d->psnr, rpGeneral });
+    if (d->flow)
+        deps.push_back({ d->flow, rpStrictSpatial });
     vsapi->createVideoFilter(out, "RIFE", &d->vi, rifeGetFrame, rifeFree, fmParallel, deps.data(), deps.size(), d.get(), core);
     d.release();
 }
 
+static void VS_CC rifeCreate(const VSMap* in, VSMap* out, [[maybe_unused]] void* userData, VSCore* core, const VSAPI* vsapi) {
+    std::shared_ptr<RIFE> rife;
+    std::shared_ptr<RIFEScheduler> scheduler;
+    std::shared_ptr<RIFEClient> client;
+
+    auto numClips{ vsapi->mapNumElements(in, "clips") };
+    if (numClips < 1) {
+        int err;
+        auto node{ vsapi->mapGetNode(in, "clip", 0, &err) };
+        if (err) {
+            vsapi->mapSetError(out, "RIFE: clip or clips must be specified");
+            return;
+        }
+
+        createOutput(in, node, out, rife, scheduler, client, core, vsapi);
+        return;
+    }
+
+    if (vsapi->mapNumElements(in, "clip") > 0) {
+        vsapi->mapSetError(out, "RIFE: clip and clips cannot both be specified");
+        return;
+    }
+
+    // a timeline or a flow belongs to a single clip
+    if (vsapi->mapNumElements(in, "timecodes") > 0 || vsapi->mapNumElements(in, "frame_times") > 0 || vsapi->mapNumElements(in, "flow") > 0) {
+        vsapi->mapSetError(out, "RIFE: timecodes, frame_times and flow cannot be used with clips");
+        return;
+    }
+
+    // one output per clip, interleaved on the GPU by the shared scheduler
+    for (auto i{ 0 }; i < numClips; i++) {
+        createOutput(in, vsapi->mapGetNode(in, "clips", i, nullptr), out, rife, scheduler, client, core, vsapi);
+        if (vsapi->mapGetError(out))
+            return;
+    }
+}
+
 //////////////////////////////////////////
 // Init
 
@@ -452,7 +1422,7 @@ VS_EXTERNAL_API(void) VapourSynthPluginInit2(VSPlugin* plugin, const VSPLUGINAPI
                          VS_MAKE_VERSION(9, 0), VAPOURSYNTH_API_VERSION, 0, plugin);
 
     vspapi->registerFunction("RIFE",
-                             "clip:vnode;"
+                             "clip:vnode:opt;"
                              "model:int:opt;"
                              "factor_num:int:opt;"
                              "factor_den:int:opt;"
@@ -466,7 +1436,27 @@ VS_EXTERNAL_API(void) VapourSynthPluginInit2(VSPlugin* plugin, const VSPLUGINAPI
                              "sc:int:opt;"
                              "skip:int:opt;"
                              "skip_threshold:float:opt;"
-                             "list_gpu:int:opt;",
-                             "clip:vnode;",
+                             "list_gpu:int:opt;"
+                             "idle_timeout:float:opt;"
+                             "warmup:int:opt;"
+                             "optimize:int:opt;"
+                             "autotune:int:opt;"
+                             "tuning_dir:data:opt;"
+                             "borders:int:opt;"
+                             "border_threshold:float:opt;"
+                             "roi:int:opt;"
+                             "roi_threshold:float:opt;"
+                             "roi_halo:int:opt;"
+                             "timecodes:data:opt;"
+                             "frame_times:float[]:opt;"
+                             "export_flow:int:opt;"
+                             "flow:vnode:opt;"
+                             "cache_dir:data:opt;"
+                             "cache_fp16:int:opt;"
+                             "cache_mb:int:opt;"
+                             "clips:vnode[]:opt;"
+                             "flow_scale:int:opt;"
+                             "server:data:opt;",
+                             "clip:vnode[];",
                              rifeCreate, nullptr, plugin);
 }
@@ -2,7 +2,14 @@
 
 #include "rife.h"
 
+#include <math.h>
+#include <string.h>
+
 #include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
 #include <vector>
 #include "benchmark.h"
 
@@ -10,6 +17,10 @@
 #include "rife_postproc.comp.hex.h"
 #include "rife_preproc_tta.comp.hex.h"
 #include "rife_postproc_tta.comp.hex.h"
+#include "rife_preproc_uhd.comp.hex.h"
+#include "rife_preproc_tta_uhd.comp.hex.h"
+#include "rife_uhd_flow.comp.hex.h"
+#include "rife_uhd_flow_pack4.comp.hex.h"
 #include "rife_flow_tta_avg.comp.hex.h"
 #include "rife_v2_flow_tta_avg.comp.hex.h"
 #include "rife_flow_tta_temporal_avg.comp.hex.h"
@@ -18,10 +29,21 @@
 #include "rife_v4_timestep.comp.hex.h"
 
 #include "rife_ops.h"
+#include "rife_optimize.h"
+#include "rife_spirv.h"
+#include "rife_tasks.h"
+
+#ifdef RIFE_EMBEDDED_MODELS
+#include "rife_embedded.h"
+#endif
 
 DEFINE_LAYER_CREATOR(Warp)
+DEFINE_LAYER_CREATOR(WarpConcat)
 
-RIFE::RIFE(int gpuid, bool _tta_mode, bool _uhd_mode, int _num_threads, bool _rife_v2, bool _rife_v4)
+// levels of the bisection of the models without timestep, timesteps are rounded to multiples of 1/32
+static const int bisect_depth = 5;
+
+RIFE::RIFE(int gpuid, const RIFEModelInfo& _model, bool _tta_mode, bool _uhd_mode, int _num_threads, bool _optimize)
 {
     vkdev = gpuid == -1 ? 0 : ncnn::get_gpu_device(gpuid);
 
@@ -31,16 +53,18 @@ RIFE::RIFE(int gpuid, bool _tta_mode, bool _uhd_mode, int _num_threads, bool _ri
     rife_flow_tta_temporal_avg = 0;
     rife_out_tta_temporal_avg = 0;
     rife_v4_timestep = 0;
-    rife_uhd_downscale_image = 0;
-    rife_uhd_upscale_flow = 0;
-    rife_uhd_double_flow = 0;
+    rife_uhd_flow = 0;
+    rife_uhd_flow_pack4 = 0;
     rife_v2_slice_flow = 0;
+    rife_v4_concat = 0;
     tta_mode = _tta_mode;
     tta_temporal_mode = false;
     uhd_mode = _uhd_mode;
     num_threads = _num_threads;
-    rife_v2 = _rife_v2;
-    rife_v4 = _rife_v4;
+    optimize = _optimize;
+    model = _model;
+    rife_v2 = model.rife_v2;
+    rife_v4 = model.rife_v4;
 }
 
 RIFE::~RIFE()
@@ -53,18 +77,8 @@ RIFE::~RIFE()
         delete rife_flow_tta_temporal_avg;
         delete rife_out_tta_temporal_avg;
         delete rife_v4_timestep;
-    }
-
-    if (uhd_mode)
-    {
-        rife_uhd_downscale_image->destroy_pipeline(flownet.opt);
-        delete rife_uhd_downscale_image;
-
-        rife_uhd_upscale_flow->destroy_pipeline(flownet.opt);
-        delete rife_uhd_upscale_flow;
-
-        rife_uhd_double_flow->destroy_pipeline(flownet.opt);
-        delete rife_uhd_double_flow;
+        delete rife_uhd_flow;
+        delete rife_uhd_flow_pack4;
     }
 
     if (rife_v2)
@@ -72,57 +86,99 @@ RIFE::~RIFE()
         rife_v2_slice_flow->destroy_pipeline(flownet.opt);
         delete rife_v2_slice_flow;
     }
+
+    if (rife_v4_concat)
+    {
+        rife_v4_concat->destroy_pipeline(flownet.opt);
+        delete rife_v4_concat;
+    }
+}
+
+void RIFE::set_tuning(const RIFETuning& _tuning)
+{
+    tuning = _tuning;
+}
+
+int RIFE::load_net_mem(ncnn::Net& net, const char* name, const char* param, const unsigned char* bin) const
+{
+    std::vector<std::string> outputs;
+    if (strcmp(name, "flownet") == 0)
+        outputs.push_back(model.flownet_out);
+    else if (strcmp(name, "contextnet") == 0)
+        outputs.assign(model.contextnet_out, model.contextnet_out + 4);
+    else
+        outputs.push_back(model.fusionnet_out);
+
+    // merge the warps into the concats that read them, only the graph text changes
+    std::string optimized_param;
+    if (optimize && rife_optimize_graph(param, outputs, optimized_param) > 0)
+        param = optimized_param.c_str();
+
+    if (net.load_param_mem(param) != 0)
+        return -1;
+
+    if (net.load_model(bin) == 0)
+        return -1;
+
+    return 0;
 }
 
 #if _WIN32
-static void load_param_model(ncnn::Net& net, const std::wstring& modeldir, const wchar_t* name)
+int RIFE::load(const std::wstring& modeldir)
+#else
+int RIFE::load(const std::string& modeldir)
+#endif
 {
-    wchar_t parampath[256];
-    wchar_t modelpath[256];
-    swprintf(parampath, 256, L"%s/%s.param", modeldir.c_str(), name);
-    swprintf(modelpath, 256, L"%s/%s.bin", modeldir.c_str(), name);
+    const std::filesystem::path dir(modeldir);
 
-    {
-        FILE* fp = _wfopen(parampath, L"rb");
-        if (!fp)
+    return load([&](ncnn::Net& net, NetStorage& storage, const char* name) {
+        const std::filesystem::path parampath = dir / (std::string(name) + ".param");
+        const std::filesystem::path modelpath = dir / (std::string(name) + ".bin");
+
+        // the text graph is only a few kilobytes, read it in one go and parse it from memory
+        std::string param;
         {
-            fwprintf(stderr, L"_wfopen %ls failed\n", parampath);
-        }
+            std::ifstream ifs(parampath, std::ios::binary);
+            if (!ifs)
+            {
+                fprintf(stderr, "open %s failed\n", reinterpret_cast<const char*>(parampath.u8string().c_str()));
+                return -1;
+            }
 
-        net.load_param(fp);
+            param.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        }
 
-        fclose(fp);
-    }
-    {
-        FILE* fp = _wfopen(modelpath, L"rb");
-        if (!fp)
+        // ncnn references untagged fp32 blobs straight from the mapping, which is kept alive as long as
+        // the net, fp16 tagged ones like those of the shipped models are converted into fp32 copies
+        if (storage.mapping.open(modelpath) != 0)
         {
-            fwprintf(stderr, L"_wfopen %ls failed\n", modelpath);
+            fprintf(stderr, "mmap %s failed\n", reinterpret_cast<const char*>(modelpath.u8string().c_str()));
+            return -1;
         }
 
-        net.load_model(fp);
-
-        fclose(fp);
-    }
+        return load_net_mem(net, name, param.c_str(), storage.mapping.data());
+    });
 }
-#else
-static void load_param_model(ncnn::Net& net, const std::string& modeldir, const char* name)
+
+#ifdef RIFE_EMBEDDED_MODELS
+int RIFE::load_embedded(const std::string& modelname)
 {
-    char parampath[256];
-    char modelpath[256];
-    sprintf(parampath, "%s/%s.param", modeldir.c_str(), name);
-    sprintf(modelpath, "%s/%s.bin", modeldir.c_str(), name);
+    return load([&](ncnn::Net& net, NetStorage& storage, const char* name) {
+        const rife_embedded_net* embedded = rife_find_embedded_net(modelname.c_str(), name);
+        if (!embedded)
+        {
+            fprintf(stderr, "%s/%s is not embedded\n", modelname.c_str(), name);
+            return -1;
+        }
 
-    net.load_param(parampath);
-    net.load_model(modelpath);
+        // the param text and the weights are read-only data of the module, nothing is copied
+        // but a rewritten graph text
+        return load_net_mem(net, name, embedded->param, embedded->bin);
+    });
 }
-#endif
+#endif // RIFE_EMBEDDED_MODELS
 
-#if _WIN32
-int RIFE::load(const std::wstring& modeldir)
-#else
-int RIFE::load(const std::string& modeldir)
-#endif
+int RIFE::load(const std::function<int(ncnn::Net&, NetStorage&, const char*)>& load_net)
 {
     ncnn::Option opt;
     opt.num_threads = num_threads;
@@ -131,6 +187,7 @@ int RIFE::load(const std::string& modeldir)
     opt.use_fp16_storage = vkdev ? true : false;
     opt.use_fp16_arithmetic = false;
     opt.use_int8_storage = false;
+    tuning.apply(opt);
 
     flownet.opt = opt;
     contextnet.opt = opt;
@@ -144,21 +201,22 @@ int RIFE::load(const std::string& modeldir)
     contextnet.register_custom_layer("rife.Warp", Warp_layer_creator);
     fusionnet.register_custom_layer("rife.Warp", Warp_layer_creator);
 
-#if _WIN32
-    load_param_model(flownet, modeldir, L"flownet");
-    if (!rife_v4)
-    {
-        load_param_model(contextnet, modeldir, L"contextnet");
-        load_param_model(fusionnet, modeldir, L"fusionnet");
-    }
-#else
-    load_param_model(flownet, modeldir, "flownet");
+    flownet.register_custom_layer("rife.WarpConcat", WarpConcat_layer_creator);
+    contextnet.register_custom_layer("rife.WarpConcat", WarpConcat_layer_creator);
+    fusionnet.register_custom_layer("rife.WarpConcat", WarpConcat_layer_creator);
+
+    // the nets and the custom pipelines below do not depend on each other,
+    // load and compile them on the shared workers and wait for the slowest one
+    RIFETaskGroup jobs;
+
+    int ret[3] = {};
+
+    jobs.run([&] { ret[0] = load_net(flownet, flownet_model, "flownet"); });
     if (!rife_v4)
     {
-        load_param_model(contextnet, modeldir, "contextnet");
-        load_param_model(fusionnet, modeldir, "fusionnet");
+        jobs.run([&] { ret[1] = load_net(contextnet, contextnet_model, "contextnet"); });
+        jobs.run([&] { ret[2] = load_net(fusionnet, fusionnet_model, "fusionnet"); });
     }
-#endif
 
     // initialize preprocess and postprocess pipeline
     if (vkdev)
@@ -170,26 +228,35 @@ int RIFE::load(const std::string& modeldir)
         specializations[0].i = 0;
 #endif
 
-        {
+        jobs.run([&, specializations] {
             std::vector<uint32_t> spirv;
             static ncnn::Mutex lock;
             {
                 ncnn::MutexLockGuard guard(lock);
                 if (spirv.empty())
                 {
-                    if (tta_mode)
-                        compile_spirv_module(rife_preproc_tta_comp_data, sizeof(rife_preproc_tta_comp_data), opt, spirv);
+                    // in uhd mode the half resolution flownet inputs are written by the same pass
+                    if (tta_mode && uhd_mode && !rife_v4)
+                        rife_compile_spirv("rife_preproc_tta_uhd", rife_preproc_tta_uhd_comp_data, sizeof(rife_preproc_tta_uhd_comp_data), opt, spirv);
+                    else if (tta_mode)
+                        rife_compile_spirv("rife_preproc_tta", rife_preproc_tta_comp_data, sizeof(rife_preproc_tta_comp_data), opt, spirv);
+                    else if (uhd_mode && !rife_v4)
+                        rife_compile_spirv("rife_preproc_uhd", rife_preproc_uhd_comp_data, sizeof(rife_preproc_uhd_comp_data), opt, spirv);
                     else
-                        compile_spirv_module(rife_preproc_comp_data, sizeof(rife_preproc_comp_data), opt, spirv);
+                        rife_compile_spirv("rife_preproc", rife_preproc_comp_data, sizeof(rife_preproc_comp_data), opt, spirv);
                 }
             }
 
-            rife_preproc = new ncnn::Pipeline(vkdev);
-            rife_preproc->set_optimal_local_size_xyz(8, 8, 3);
-            rife_preproc->create(spirv.data(), spirv.size() * 4, specializations);
-        }
+            rife_preproc = new SpecializedPipeline(vkdev, uhd_mode && !rife_v4 ? 9 : 6);
+            rife_preproc->set_optimal_local_size_xyz(tuning.local_size_w, tuning.local_size_h, 3);
+            // the uhd variants have no bgr constant
+            if (uhd_mode && !rife_v4)
+                rife_preproc->create(spirv.data(), spirv.size() * 4, std::vector<ncnn::vk_specialization_type>());
+            else
+                rife_preproc->create(spirv.data(), spirv.size() * 4, specializations);
+        });
 
-        {
+        jobs.run([&, specializations] {
             std::vector<uint32_t> spirv;
             static ncnn::Mutex lock;
             {
@@ -197,132 +264,139 @@ int RIFE::load(const std::string& modeldir)
                 if (spirv.empty())
                 {
                     if (tta_mode)
-                        compile_spirv_module(rife_postproc_tta_comp_data, sizeof(rife_postproc_tta_comp_data), opt, spirv);
+                        rife_compile_spirv("rife_postproc_tta", rife_postproc_tta_comp_data, sizeof(rife_postproc_tta_comp_data), opt, spirv);
                     else
-                        compile_spirv_module(rife_postproc_comp_data, sizeof(rife_postproc_comp_data), opt, spirv);
+                        rife_compile_spirv("rife_postproc", rife_postproc_comp_data, sizeof(rife_postproc_comp_data), opt, spirv);
                 }
             }
 
-            rife_postproc = new ncnn::Pipeline(vkdev);
-            rife_postproc->set_optimal_local_size_xyz(8, 8, 3);
+            rife_postproc = new SpecializedPipeline(vkdev, 6);
+            rife_postproc->set_optimal_local_size_xyz(tuning.local_size_w, tuning.local_size_h, 3);
             rife_postproc->create(spirv.data(), spirv.size() * 4, specializations);
-        }
+        });
     }
 
     if (vkdev && tta_mode)
     {
-        std::vector<uint32_t> spirv;
-        static ncnn::Mutex lock;
-        {
-            ncnn::MutexLockGuard guard(lock);
-            if (spirv.empty())
+        jobs.run([&] {
+            std::vector<uint32_t> spirv;
+            static ncnn::Mutex lock;
             {
-                if (rife_v2)
-                {
-                    compile_spirv_module(rife_v2_flow_tta_avg_comp_data, sizeof(rife_v2_flow_tta_avg_comp_data), opt, spirv);
-                }
-                else
+                ncnn::MutexLockGuard guard(lock);
+                if (spirv.empty())
                 {
-                    compile_spirv_module(rife_flow_tta_avg_comp_data, sizeof(rife_flow_tta_avg_comp_data), opt, spirv);
+                    if (rife_v2)
+                    {
+                        rife_compile_spirv("rife_v2_flow_tta_avg", rife_v2_flow_tta_avg_comp_data, sizeof(rife_v2_flow_tta_avg_comp_data), opt, spirv);
+                    }
+                    else
+                    {
+                        rife_compile_spirv("rife_flow_tta_avg", rife_flow_tta_avg_comp_data, sizeof(rife_flow_tta_avg_comp_data), opt, spirv);
+                    }
                 }
             }
-        }
 
-        std::vector<ncnn::vk_specialization_type> specializations(0);
+            std::vector<ncnn::vk_specialization_type> specializations(0);
 
-        rife_flow_tta_avg = new ncnn::Pipeline(vkdev);
-        rife_flow_tta_avg->set_optimal_local_size_xyz(8, 8, 1);
-        rife_flow_tta_avg->create(spirv.data(), spirv.size() * 4, specializations);
+            rife_flow_tta_avg = new SpecializedPipeline(vkdev, 3);
+            rife_flow_tta_avg->set_optimal_local_size_xyz(tuning.local_size_w, tuning.local_size_h, 1);
+            rife_flow_tta_avg->create(spirv.data(), spirv.size() * 4, specializations);
+        });
     }
 
     if (vkdev && tta_temporal_mode)
     {
-        std::vector<uint32_t> spirv;
-        static ncnn::Mutex lock;
-        {
-            ncnn::MutexLockGuard guard(lock);
-            if (spirv.empty())
+        jobs.run([&] {
+            std::vector<uint32_t> spirv;
+            static ncnn::Mutex lock;
             {
-                if (rife_v2)
-                {
-                    compile_spirv_module(rife_v2_flow_tta_temporal_avg_comp_data, sizeof(rife_v2_flow_tta_temporal_avg_comp_data), opt, spirv);
-                }
-                else
+                ncnn::MutexLockGuard guard(lock);
+                if (spirv.empty())
                 {
-                    compile_spirv_module(rife_flow_tta_temporal_avg_comp_data, sizeof(rife_flow_tta_temporal_avg_comp_data), opt, spirv);
+                    if (rife_v2)
+                    {
+                        rife_compile_spirv("rife_v2_flow_tta_temporal_avg", rife_v2_flow_tta_temporal_avg_comp_data, sizeof(rife_v2_flow_tta_temporal_avg_comp_data), opt, spirv);
+                    }
+                    else
+                    {
+                        rife_compile_spirv("rife_flow_tta_temporal_avg", rife_flow_tta_temporal_avg_comp_data, sizeof(rife_flow_tta_temporal_avg_comp_data), opt, spirv);
+                    }
                 }
             }
-        }
 
-        std::vector<ncnn::vk_specialization_type> specializations(0);
+            std::vector<ncnn::vk_specialization_type> specializations(0);
 
-        rife_flow_tta_temporal_avg = new ncnn::Pipeline(vkdev);
-        rife_flow_tta_temporal_avg->set_optimal_local_size_xyz(8, 8, 1);
-        rife_flow_tta_temporal_avg->create(spirv.data(), spirv.size() * 4, specializations);
+            rife_flow_tta_temporal_avg = new SpecializedPipeline(vkdev, 3);
+            rife_flow_tta_temporal_avg->set_optimal_local_size_xyz(tuning.local_size_w, tuning.local_size_h, 1);
+            rife_flow_tta_temporal_avg->create(spirv.data(), spirv.size() * 4, specializations);
+        });
     }
 
     if (vkdev && tta_temporal_mode)
     {
-        std::vector<uint32_t> spirv;
-        static ncnn::Mutex lock;
-        {
-            ncnn::MutexLockGuard guard(lock);
-            if (spirv.empty())
+        jobs.run([&] {
+            std::vector<uint32_t> spirv;
+            static ncnn::Mutex lock;
             {
-                compile_spirv_module(rife_out_tta_temporal_avg_comp_data, sizeof(rife_out_tta_temporal_avg_comp_data), opt, spirv);
+                ncnn::MutexLockGuard guard(lock);
+                if (spirv.empty())
+                {
+                    rife_compile_spirv("rife_out_tta_temporal_avg", rife_out_tta_temporal_avg_comp_data, sizeof(rife_out_tta_temporal_avg_comp_data), opt, spirv);
+                }
             }
-        }
 
-        std::vector<ncnn::vk_specialization_type> specializations(0);
+            std::vector<ncnn::vk_specialization_type> specializations(0);
 
-        rife_out_tta_temporal_avg = new ncnn::Pipeline(vkdev);
-        rife_out_tta_temporal_avg->set_optimal_local_size_xyz(8, 8, 1);
-        rife_out_tta_temporal_avg->create(spirv.data(), spirv.size() * 4, specializations);
+            rife_out_tta_temporal_avg = new SpecializedPipeline(vkdev, 3);
+            rife_out_tta_temporal_avg->set_optimal_local_size_xyz(tuning.local_size_w, tuning.local_size_h, 1);
+            rife_out_tta_temporal_avg->create(spirv.data(), spirv.size() * 4, specializations);
+        });
     }
 
-    if (uhd_mode)
+    // v4 flownets downscale internally, driven by their scale input, the others take the half
+    // resolution frames from preproc and have their flow upscaled and doubled in one pass
+    if (vkdev && uhd_mode && !rife_v4)
     {
-        {
-            rife_uhd_downscale_image = ncnn::create_layer("Interp");
-            rife_uhd_downscale_image->vkdev = vkdev;
-
-            ncnn::ParamDict pd;
-            pd.set(0, 2);// bilinear
-            pd.set(1, 0.5f);
-            pd.set(2, 0.5f);
-            rife_uhd_downscale_image->load_param(pd);
+        jobs.run([&] {
+            std::vector<uint32_t> spirv;
+            static ncnn::Mutex lock;
+            {
+                ncnn::MutexLockGuard guard(lock);
+                if (spirv.empty())
+                {
+                    rife_compile_spirv("rife_uhd_flow", rife_uhd_flow_comp_data, sizeof(rife_uhd_flow_comp_data), opt, spirv);
+                }
+            }
 
-            rife_uhd_downscale_image->create_pipeline(opt);
-        }
-        {
-            rife_uhd_upscale_flow = ncnn::create_layer("Interp");
-            rife_uhd_upscale_flow->vkdev = vkdev;
+            std::vector<ncnn::vk_specialization_type> specializations(0);
 
-            ncnn::ParamDict pd;
-            pd.set(0, 2);// bilinear
-            pd.set(1, 2.f);
-            pd.set(2, 2.f);
-            rife_uhd_upscale_flow->load_param(pd);
+            rife_uhd_flow = new SpecializedPipeline(vkdev, 7);
+            rife_uhd_flow->set_optimal_local_size_xyz(tuning.local_size_w, tuning.local_size_h, 1);
+            rife_uhd_flow->create(spirv.data(), spirv.size() * 4, specializations);
+        });
 
-            rife_uhd_upscale_flow->create_pipeline(opt);
-        }
-        {
-            rife_uhd_double_flow = ncnn::create_layer("BinaryOp");
-            rife_uhd_double_flow->vkdev = vkdev;
+        jobs.run([&] {
+            std::vector<uint32_t> spirv;
+            static ncnn::Mutex lock;
+            {
+                ncnn::MutexLockGuard guard(lock);
+                if (spirv.empty())
+                {
+                    rife_compile_spirv("rife_uhd_flow_pack4", rife_uhd_flow_pack4_comp_data, sizeof(rife_uhd_flow_pack4_comp_data), opt, spirv);
+                }
+            }
 
-            ncnn::ParamDict pd;
-            pd.set(0, 2);// mul
-            pd.set(1, 1);// with_scalar
-            pd.set(2, 2.f);// b
-            rife_uhd_double_flow->load_param(pd);
+            std::vector<ncnn::vk_specialization_type> specializations(0);
 
-            rife_uhd_double_flow->create_pipeline(opt);
-        }
+            rife_uhd_flow_pack4 = new SpecializedPipeline(vkdev, 7);
+            rife_uhd_flow_pack4->set_optimal_local_size_xyz(tuning.local_size_w, tuning.local_size_h, 1);
+            rife_uhd_flow_pack4->create(spirv.data(), spirv.size() * 4, specializations);
+        });
     }
 
     if (rife_v2)
     {
-        {
+        jobs.run([&] {
             rife_v2_slice_flow = ncnn::create_layer("Slice");
             rife_v2_slice_flow->vkdev = vkdev;
 
@@ -336,34 +410,90 @@ int RIFE::load(const std::string& modeldir)
             rife_v2_slice_flow->load_param(pd);
 
             rife_v2_slice_flow->create_pipeline(opt);
-        }
+        });
     }
 
     if (rife_v4)
     {
         if (vkdev)
         {
-            std::vector<uint32_t> spirv;
-            static ncnn::Mutex lock;
-            {
-                ncnn::MutexLockGuard guard(lock);
-                if (spirv.empty())
+            jobs.run([&] {
+                std::vector<uint32_t> spirv;
+                static ncnn::Mutex lock;
                 {
-                    compile_spirv_module(rife_v4_timestep_comp_data, sizeof(rife_v4_timestep_comp_data), opt, spirv);
+                    ncnn::MutexLockGuard guard(lock);
+                    if (spirv.empty())
+                    {
+                        rife_compile_spirv("rife_v4_timestep", rife_v4_timestep_comp_data, sizeof(rife_v4_timestep_comp_data), opt, spirv);
+                    }
                 }
-            }
 
-            std::vector<ncnn::vk_specialization_type> specializations;
+                std::vector<ncnn::vk_specialization_type> specializations;
+
+                rife_v4_timestep = new SpecializedPipeline(vkdev, 3);
+                rife_v4_timestep->set_optimal_local_size_xyz(tuning.local_size_w, tuning.local_size_h, 1);
+                rife_v4_timestep->create(spirv.data(), spirv.size() * 4, specializations);
+            });
+        }
+    }
+
+    jobs.wait();
+
+    if (ret[0] != 0 || ret[1] != 0 || ret[2] != 0)
+        return -1;
+
+    if (rife_v4)
+    {
+        if (resolve_v4_inputs() != 0)
+            return -1;
+
+        if (model.flownet_inputs != "separate")
+        {
+            rife_v4_concat = ncnn::create_layer("Concat");
+            rife_v4_concat->vkdev = vkdev;
+
+            ncnn::ParamDict pd;
+            pd.set(0, 0);// axis
+            rife_v4_concat->load_param(pd);
 
-            rife_v4_timestep = new ncnn::Pipeline(vkdev);
-            rife_v4_timestep->set_optimal_local_size_xyz(8, 8, 1);
-            rife_v4_timestep->create(spirv.data(), spirv.size() * 4, specializations);
+            rife_v4_concat->create_pipeline(opt);
         }
     }
 
     return 0;
 }
 
+int RIFE::resolve_v4_inputs()
+{
+    const std::vector<const char*>& names = flownet.input_names();
+
+    return rife_model_resolve_inputs(std::vector<std::string>(names.begin(), names.end()), uhd_mode, model, flownet_inputs);
+}
+
+void RIFE::upscale_uhd_flow(const ncnn::VkMat& flow_downscaled, ncnn::VkMat& flow, ncnn::VkCompute& cmd, const ncnn::Option& opt) const
+{
+    // bilinear upscale by 2 and double the vectors, the flow holds at most 4 channels so it is
+    // either unpacked or pack4
+    flow.create(flow_downscaled.w * 2, flow_downscaled.h * 2, flow_downscaled.c, flow_downscaled.elemsize, flow_downscaled.elempack, opt.blob_vkallocator);
+
+    std::vector<ncnn::VkMat> bindings(2);
+    bindings[0] = flow_downscaled;
+    bindings[1] = flow;
+
+    std::vector<ncnn::vk_constant_type> constants(7);
+    constants[0].i = flow_downscaled.w;
+    constants[1].i = flow_downscaled.h;
+    constants[2].i = flow_downscaled.c;
+    constants[3].i = flow_downscaled.cstep;
+    constants[4].i = flow.w;
+    constants[5].i = flow.h;
+    constants[6].i = flow.cstep;
+
+    const SpecializedPipeline* pipeline = flow_downscaled.elempack == 4 ? rife_uhd_flow_pack4 : rife_uhd_flow;
+
+    cmd.record_pipeline(pipeline->get(constants), bindings, constants, flow);
+}
+
 int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                   const float* src1R, const float* src1G, const float* src1B,
                   float* dstR, float* dstG, float* dstB,
@@ -372,6 +502,41 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
     if (rife_v4)
         return process_v4(src0R, src0G, src0B, src1R, src1G, src1B, dstR, dstG, dstB, w, h, stride, timestep);
 
+    return process_multi(src0R, src0G, src0B, src1R, src1G, src1B, &dstR, &dstG, &dstB, &timestep, 1, w, h, stride);
+}
+
+int RIFE::process_multi(const float* src0R, const float* src0G, const float* src0B,
+                        const float* src1R, const float* src1G, const float* src1B,
+                        float* const* dstR, float* const* dstG, float* const* dstB, const float* timesteps, const int count,
+                        const int w, const int h, const ptrdiff_t stride, ncnn::Mat* flow_out, const ncnn::Mat* flow_in) const
+{
+    if (flow_in && (rife_v4 || tta_mode))
+    {
+        fprintf(stderr, "flow import is not supported by rife-v4 models and in tta mode\n");
+        return -1;
+    }
+
+    if (flow_in && flow_in->c != model.flow_channels())
+    {
+        fprintf(stderr, "imported flow has %d components, the model estimates %d\n", flow_in->c, model.flow_channels());
+        return -1;
+    }
+
+    if (rife_v4)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            int ret = process_v4(src0R, src0G, src0B, src1R, src1G, src1B, dstR[i], dstG[i], dstB[i], w, h, stride, timesteps[i]);
+            if (ret != 0)
+                return ret;
+        }
+
+        return 0;
+    }
+
+    // pipelines specialized for other sizes are not destroyed under the commands recorded here
+    SpecializedPipeline::Use use;
+
     const int channels = 3;//in0image.elempack;
 
 //     fprintf(stderr, "%d x %d\n", w, h);
@@ -384,12 +549,6 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
     opt.workspace_vkallocator = blob_vkallocator;
     opt.staging_vkallocator = staging_vkallocator;
 
-    // pad to 32n
-    int w_padded = (w + 31) / 32 * 32;
-    int h_padded = (h + 31) / 32 * 32;
-
-    const size_t in_out_tile_elemsize = opt.use_fp16_storage ? 2u : 4u;
-
     ncnn::Mat in0;
     ncnn::Mat in1;
     in0.create(w, h, channels, sizeof(float), 1);
@@ -421,13 +580,161 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
         cmd.record_clone(in1, in1_gpu, opt);
     }
 
-    ncnn::VkMat out_gpu;
+    // the models only predict the midpoint, other timesteps are reached by bisecting, the tree is
+    // indexed in steps of 1 / span with the source frames at both ends, and every midpoint is
+    // computed once on the gpu and stays there as an input of the level below and of its siblings
+    const int span = 1 << bisect_depth;
+    std::map<int, ncnn::VkMat> nodes;
+    nodes[0] = in0_gpu;
+    nodes[span] = in1_gpu;
+    in0_gpu.release();
+    in1_gpu.release();
+
+    // an imported flow is padded like the frames, the margin does not move
+    ncnn::VkMat flow_in_gpu;
+    if (flow_in)
+    {
+        const int w_padded = (w + model.padding - 1) / model.padding * model.padding;
+        const int h_padded = (h + model.padding - 1) / model.padding * model.padding;
+
+        ncnn::Mat flow_padded(w_padded, h_padded, flow_in->c);
+        flow_padded.fill(0.f);
+        for (int q = 0; q < flow_in->c; q++)
+        {
+            for (int y = 0; y < h; y++)
+            {
+                memcpy(flow_padded.channel(q).row(y), flow_in->channel(q).row(y), w * sizeof(float));
+            }
+        }
+
+        // stored like the blob flownet extracts, fp16 with fp16 storage and packed by 4 channels
+        cmd.record_upload(flow_padded, flow_in_gpu, opt);
+    }
+
+    // the flow of the pair is the one estimated for the first midpoint, the levels below bisect halves of it
+    ncnn::VkMat flow_gpu;
+    if (flow_out || flow_in)
+    {
+        ncnn::VkMat node0 = nodes[0];
+        ncnn::VkMat node1 = nodes[span];
+        interpolate_gpu(node0, node1, nodes[span / 2], cmd, opt, flow_out ? &flow_gpu : 0, flow_in ? &flow_in_gpu : 0);
+        flow_in_gpu.release();
+    }
+
+    std::vector<int> targets(count);
+    for (int i = 0; i < count; i++)
+    {
+        const int target = std::clamp(static_cast<int>(lroundf(timesteps[i] * span)), 0, span);
+        targets[i] = target;
+
+        int lo = 0;
+        int hi = span;
+        while (nodes.find(target) == nodes.end())
+        {
+            const int mid = (lo + hi) / 2;
+            if (nodes.find(mid) == nodes.end())
+            {
+                // interpolate_gpu releases what it is given, the tree keeps its own references
+                ncnn::VkMat node0 = nodes[lo];
+                ncnn::VkMat node1 = nodes[hi];
+                interpolate_gpu(node0, node1, nodes[mid], cmd, opt);
+            }
+
+            if (target < mid)
+                hi = mid;
+            else
+                lo = mid;
+        }
+    }
+
+    // download
+    {
+        std::vector<ncnn::Mat> outs(count);
+        for (int i = 0; i < count; i++)
+        {
+            cmd.record_clone(nodes[targets[i]], outs[i], opt);
+        }
+
+        ncnn::Mat flow_padded;
+        if (flow_out)
+        {
+            cmd.record_clone(flow_gpu, flow_padded, opt);
+        }
+
+        cmd.submit_and_wait();
+
+        nodes.clear();
+        flow_gpu.release();
+
+        if (flow_out)
+        {
+            // unpacked fp32 at the size of the frames
+            if (flow_padded.elembits() == 16)
+            {
+                ncnn::Mat flow_fp32;
+                ncnn::cast_float16_to_float32(flow_padded, flow_fp32);
+                flow_padded = flow_fp32;
+            }
+            if (flow_padded.elempack != 1)
+            {
+                ncnn::Mat flow_unpacked;
+                ncnn::convert_packing(flow_padded, flow_unpacked, 1);
+                flow_padded = flow_unpacked;
+            }
+
+            flow_out->create(w, h, flow_padded.c, sizeof(float));
+            for (int q = 0; q < flow_padded.c; q++)
+            {
+                for (int y = 0; y < h; y++)
+                {
+                    memcpy(flow_out->channel(q).row(y), flow_padded.channel(q).row(y), w * sizeof(float));
+                }
+            }
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            const float* outR{ outs[i].channel(0) };
+            const float* outG{ outs[i].channel(1) };
+            const float* outB{ outs[i].channel(2) };
+            for (auto y{ 0 }; y < h; y++) {
+                for (auto x{ 0 }; x < w; x++) {
+                    dstR[i][stride * y + x] = outR[w * y + x] * (1 / 255.0f);
+                    dstG[i][stride * y + x] = outG[w * y + x] * (1 / 255.0f);
+                    dstB[i][stride * y + x] = outB[w * y + x] * (1 / 255.0f);
+                }
+            }
+        }
+    }
+
+    vkdev->reclaim_blob_allocator(blob_vkallocator);
+    vkdev->reclaim_staging_allocator(staging_vkallocator);
+
+    return 0;
+}
+
+void RIFE::interpolate_gpu(ncnn::VkMat& in0_gpu, ncnn::VkMat& in1_gpu, ncnn::VkMat& out_gpu, ncnn::VkCompute& cmd, const ncnn::Option& opt, ncnn::VkMat* flow_out, const ncnn::VkMat* flow_in) const
+{
+    const int channels = 3;
+    const int w = in0_gpu.w;
+    const int h = in0_gpu.h;
+
+    ncnn::VkAllocator* blob_vkallocator = opt.blob_vkallocator;
+    ncnn::VkAllocator* staging_vkallocator = opt.staging_vkallocator;
+
+    // pad to the granularity the model needs
+    int w_padded = (w + model.padding - 1) / model.padding * model.padding;
+    int h_padded = (h + model.padding - 1) / model.padding * model.padding;
+
+    const size_t in_out_tile_elemsize = opt.use_fp16_storage ? 2u : 4u;
 
     if (tta_mode)
     {
         // preproc
         ncnn::VkMat in0_gpu_padded[8];
         ncnn::VkMat in1_gpu_padded[8];
+        ncnn::VkMat in0_gpu_padded_downscaled[8];
+        ncnn::VkMat in1_gpu_padded_downscaled[8];
         {
             in0_gpu_padded[0].create(w_padded, h_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
             in0_gpu_padded[1].create(w_padded, h_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
@@ -438,26 +745,66 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             in0_gpu_padded[6].create(h_padded, w_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
             in0_gpu_padded[7].create(h_padded, w_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
 
-            std::vector<ncnn::VkMat> bindings(9);
-            bindings[0] = in0_gpu;
-            bindings[1] = in0_gpu_padded[0];
-            bindings[2] = in0_gpu_padded[1];
-            bindings[3] = in0_gpu_padded[2];
-            bindings[4] = in0_gpu_padded[3];
-            bindings[5] = in0_gpu_padded[4];
-            bindings[6] = in0_gpu_padded[5];
-            bindings[7] = in0_gpu_padded[6];
-            bindings[8] = in0_gpu_padded[7];
-
-            std::vector<ncnn::vk_constant_type> constants(6);
-            constants[0].i = in0_gpu.w;
-            constants[1].i = in0_gpu.h;
-            constants[2].i = in0_gpu.cstep;
-            constants[3].i = in0_gpu_padded[0].w;
-            constants[4].i = in0_gpu_padded[0].h;
-            constants[5].i = in0_gpu_padded[0].cstep;
+            if (uhd_mode)
+            {
+                in0_gpu_padded_downscaled[0].create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in0_gpu_padded_downscaled[1].create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in0_gpu_padded_downscaled[2].create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in0_gpu_padded_downscaled[3].create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in0_gpu_padded_downscaled[4].create(h_padded / 2, w_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in0_gpu_padded_downscaled[5].create(h_padded / 2, w_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in0_gpu_padded_downscaled[6].create(h_padded / 2, w_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in0_gpu_padded_downscaled[7].create(h_padded / 2, w_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+
+                std::vector<ncnn::VkMat> bindings(17);
+                bindings[0] = in0_gpu;
+                for (int ti = 0; ti < 8; ti++)
+                {
+                    bindings[1 + ti] = in0_gpu_padded[ti];
+                    bindings[9 + ti] = in0_gpu_padded_downscaled[ti];
+                }
 
-            cmd.record_pipeline(rife_preproc, bindings, constants, in0_gpu_padded[0]);
+                std::vector<ncnn::vk_constant_type> constants(9);
+                constants[0].i = in0_gpu.w;
+                constants[1].i = in0_gpu.h;
+                constants[2].i = in0_gpu.cstep;
+                constants[3].i = in0_gpu_padded[0].w;
+                constants[4].i = in0_gpu_padded[0].h;
+                constants[5].i = in0_gpu_padded[0].cstep;
+                constants[6].i = in0_gpu_padded_downscaled[0].w;
+                constants[7].i = in0_gpu_padded_downscaled[0].h;
+                constants[8].i = in0_gpu_padded_downscaled[0].cstep;
+
+                // one invocation per 2x2 block
+                ncnn::VkMat dispatcher;
+                dispatcher.w = in0_gpu_padded_downscaled[0].w;
+                dispatcher.h = in0_gpu_padded_downscaled[0].h;
+                dispatcher.c = 3;
+                cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, dispatcher);
+            }
+            else
+            {
+                std::vector<ncnn::VkMat> bindings(9);
+                bindings[0] = in0_gpu;
+                bindings[1] = in0_gpu_padded[0];
+                bindings[2] = in0_gpu_padded[1];
+                bindings[3] = in0_gpu_padded[2];
+                bindings[4] = in0_gpu_padded[3];
+                bindings[5] = in0_gpu_padded[4];
+                bindings[6] = in0_gpu_padded[5];
+                bindings[7] = in0_gpu_padded[6];
+                bindings[8] = in0_gpu_padded[7];
+
+                std::vector<ncnn::vk_constant_type> constants(6);
+                constants[0].i = in0_gpu.w;
+                constants[1].i = in0_gpu.h;
+                constants[2].i = in0_gpu.cstep;
+                constants[3].i = in0_gpu_padded[0].w;
+                constants[4].i = in0_gpu_padded[0].h;
+                constants[5].i = in0_gpu_padded[0].cstep;
+
+                cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, in0_gpu_padded[0]);
+            }
         }
         {
             in1_gpu_padded[0].create(w_padded, h_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
@@ -469,26 +816,66 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             in1_gpu_padded[6].create(h_padded, w_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
             in1_gpu_padded[7].create(h_padded, w_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
 
-            std::vector<ncnn::VkMat> bindings(9);
-            bindings[0] = in1_gpu;
-            bindings[1] = in1_gpu_padded[0];
-            bindings[2] = in1_gpu_padded[1];
-            bindings[3] = in1_gpu_padded[2];
-            bindings[4] = in1_gpu_padded[3];
-            bindings[5] = in1_gpu_padded[4];
-            bindings[6] = in1_gpu_padded[5];
-            bindings[7] = in1_gpu_padded[6];
-            bindings[8] = in1_gpu_padded[7];
-
-            std::vector<ncnn::vk_constant_type> constants(6);
-            constants[0].i = in1_gpu.w;
-            constants[1].i = in1_gpu.h;
-            constants[2].i = in1_gpu.cstep;
-            constants[3].i = in1_gpu_padded[0].w;
-            constants[4].i = in1_gpu_padded[0].h;
-            constants[5].i = in1_gpu_padded[0].cstep;
+            if (uhd_mode)
+            {
+                in1_gpu_padded_downscaled[0].create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in1_gpu_padded_downscaled[1].create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in1_gpu_padded_downscaled[2].create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in1_gpu_padded_downscaled[3].create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in1_gpu_padded_downscaled[4].create(h_padded / 2, w_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in1_gpu_padded_downscaled[5].create(h_padded / 2, w_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in1_gpu_padded_downscaled[6].create(h_padded / 2, w_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+                in1_gpu_padded_downscaled[7].create(h_padded / 2, w_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+
+                std::vector<ncnn::VkMat> bindings(17);
+                bindings[0] = in1_gpu;
+                for (int ti = 0; ti < 8; ti++)
+                {
+                    bindings[1 + ti] = in1_gpu_padded[ti];
+                    bindings[9 + ti] = in1_gpu_padded_downscaled[ti];
+                }
 
-            cmd.record_pipeline(rife_preproc, bindings, constants, in1_gpu_padded[0]);
+                std::vector<ncnn::vk_constant_type> constants(9);
+                constants[0].i = in1_gpu.w;
+                constants[1].i = in1_gpu.h;
+                constants[2].i = in1_gpu.cstep;
+                constants[3].i = in1_gpu_padded[0].w;
+                constants[4].i = in1_gpu_padded[0].h;
+                constants[5].i = in1_gpu_padded[0].cstep;
+                constants[6].i = in1_gpu_padded_downscaled[0].w;
+                constants[7].i = in1_gpu_padded_downscaled[0].h;
+                constants[8].i = in1_gpu_padded_downscaled[0].cstep;
+
+                // one invocation per 2x2 block
+                ncnn::VkMat dispatcher;
+                dispatcher.w = in1_gpu_padded_downscaled[0].w;
+                dispatcher.h = in1_gpu_padded_downscaled[0].h;
+                dispatcher.c = 3;
+                cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, dispatcher);
+            }
+            else
+            {
+                std::vector<ncnn::VkMat> bindings(9);
+                bindings[0] = in1_gpu;
+                bindings[1] = in1_gpu_padded[0];
+                bindings[2] = in1_gpu_padded[1];
+                bindings[3] = in1_gpu_padded[2];
+                bindings[4] = in1_gpu_padded[3];
+                bindings[5] = in1_gpu_padded[4];
+                bindings[6] = in1_gpu_padded[5];
+                bindings[7] = in1_gpu_padded[6];
+                bindings[8] = in1_gpu_padded[7];
+
+                std::vector<ncnn::vk_constant_type> constants(6);
+                constants[0].i = in1_gpu.w;
+                constants[1].i = in1_gpu.h;
+                constants[2].i = in1_gpu.cstep;
+                constants[3].i = in1_gpu_padded[0].w;
+                constants[4].i = in1_gpu_padded[0].h;
+                constants[5].i = in1_gpu_padded[0].cstep;
+
+                cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, in1_gpu_padded[0]);
+            }
         }
 
         ncnn::VkMat flow[8];
@@ -502,27 +889,19 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
 
             if (uhd_mode)
             {
-                ncnn::VkMat in0_gpu_padded_downscaled;
-                ncnn::VkMat in1_gpu_padded_downscaled;
-                rife_uhd_downscale_image->forward(in0_gpu_padded[ti], in0_gpu_padded_downscaled, cmd, opt);
-                rife_uhd_downscale_image->forward(in1_gpu_padded[ti], in1_gpu_padded_downscaled, cmd, opt);
-
-                ex.input("input0", in0_gpu_padded_downscaled);
-                ex.input("input1", in1_gpu_padded_downscaled);
+                ex.input(model.flownet_in0.c_str(), in0_gpu_padded_downscaled[ti]);
+                ex.input(model.flownet_in1.c_str(), in1_gpu_padded_downscaled[ti]);
 
                 ncnn::VkMat flow_downscaled;
-                ex.extract("flow", flow_downscaled, cmd);
-
-                ncnn::VkMat flow_half;
-                rife_uhd_upscale_flow->forward(flow_downscaled, flow_half, cmd, opt);
+                ex.extract(model.flownet_out.c_str(), flow_downscaled, cmd);
 
-                rife_uhd_double_flow->forward(flow_half, flow[ti], cmd, opt);
+                upscale_uhd_flow(flow_downscaled, flow[ti], cmd, opt);
             }
             else
             {
-                ex.input("input0", in0_gpu_padded[ti]);
-                ex.input("input1", in1_gpu_padded[ti]);
-                ex.extract("flow", flow[ti], cmd);
+                ex.input(model.flownet_in0.c_str(), in0_gpu_padded[ti]);
+                ex.input(model.flownet_in1.c_str(), in1_gpu_padded[ti]);
+                ex.extract(model.flownet_out.c_str(), flow[ti], cmd);
             }
         }
 
@@ -539,31 +918,30 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
 
                 if (uhd_mode)
                 {
-                    ncnn::VkMat in0_gpu_padded_downscaled;
-                    ncnn::VkMat in1_gpu_padded_downscaled;
-                    rife_uhd_downscale_image->forward(in0_gpu_padded[ti], in0_gpu_padded_downscaled, cmd, opt);
-                    rife_uhd_downscale_image->forward(in1_gpu_padded[ti], in1_gpu_padded_downscaled, cmd, opt);
-
-                    ex.input("input0", in1_gpu_padded_downscaled);
-                    ex.input("input1", in0_gpu_padded_downscaled);
+                    ex.input(model.flownet_in0.c_str(), in1_gpu_padded_downscaled[ti]);
+                    ex.input(model.flownet_in1.c_str(), in0_gpu_padded_downscaled[ti]);
 
                     ncnn::VkMat flow_downscaled;
-                    ex.extract("flow", flow_downscaled, cmd);
+                    ex.extract(model.flownet_out.c_str(), flow_downscaled, cmd);
 
-                    ncnn::VkMat flow_half;
-                    rife_uhd_upscale_flow->forward(flow_downscaled, flow_half, cmd, opt);
-
-                    rife_uhd_double_flow->forward(flow_half, flow_reversed[ti], cmd, opt);
+                    upscale_uhd_flow(flow_downscaled, flow_reversed[ti], cmd, opt);
                 }
                 else
                 {
-                    ex.input("input0", in1_gpu_padded[ti]);
-                    ex.input("input1", in0_gpu_padded[ti]);
-                    ex.extract("flow", flow_reversed[ti], cmd);
+                    ex.input(model.flownet_in0.c_str(), in1_gpu_padded[ti]);
+                    ex.input(model.flownet_in1.c_str(), in0_gpu_padded[ti]);
+                    ex.extract(model.flownet_out.c_str(), flow_reversed[ti], cmd);
                 }
             }
         }
 
+        // the half resolution frames are only read by flownet
+        for (int ti = 0; ti < 8; ti++)
+        {
+            in0_gpu_padded_downscaled[ti].release();
+            in1_gpu_padded_downscaled[ti].release();
+        }
+
         // avg flow
         ncnn::VkMat flow0[8];
         ncnn::VkMat flow1[8];
@@ -587,7 +965,7 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             dispatcher.w = flow[0].w;
             dispatcher.h = flow[0].h;
             dispatcher.c = 1;
-            cmd.record_pipeline(rife_flow_tta_avg, bindings, constants, dispatcher);
+            cmd.record_pipeline(rife_flow_tta_avg->get(constants), bindings, constants, dispatcher);
         }
 
         if (tta_temporal_mode)
@@ -611,7 +989,7 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             dispatcher.w = flow_reversed[0].w;
             dispatcher.h = flow_reversed[0].h;
             dispatcher.c = 1;
-            cmd.record_pipeline(rife_flow_tta_avg, bindings, constants, dispatcher);
+            cmd.record_pipeline(rife_flow_tta_avg->get(constants), bindings, constants, dispatcher);
 
             // merge flow and flow_reversed
             for (int ti = 0; ti < 8; ti++)
@@ -630,10 +1008,14 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                 dispatcher.h = flow[ti].h;
                 dispatcher.c = 1;
 
-                cmd.record_pipeline(rife_flow_tta_temporal_avg, bindings, constants, dispatcher);
+                cmd.record_pipeline(rife_flow_tta_temporal_avg->get(constants), bindings, constants, dispatcher);
             }
         }
 
+        // the averaged flow in the orientation of the frames
+        if (flow_out)
+            *flow_out = flow[0];
+
         if (rife_v2)
         {
             for (int ti = 0; ti < 8; ti++)
@@ -659,19 +1041,19 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                 ex.set_workspace_vkallocator(blob_vkallocator);
                 ex.set_staging_vkallocator(staging_vkallocator);
 
-                ex.input("input.1", in0_gpu_padded[ti]);
+                ex.input(model.contextnet_in.c_str(), in0_gpu_padded[ti]);
                 if (rife_v2)
                 {
-                    ex.input("flow.0", flow0[ti]);
+                    ex.input(model.contextnet_flow0.c_str(), flow0[ti]);
                 }
                 else
                 {
-                    ex.input("flow.0", flow[ti]);
+                    ex.input(model.contextnet_flow0.c_str(), flow[ti]);
                 }
-                ex.extract("f1", ctx0[0], cmd);
-                ex.extract("f2", ctx0[1], cmd);
-                ex.extract("f3", ctx0[2], cmd);
-                ex.extract("f4", ctx0[3], cmd);
+                ex.extract(model.contextnet_out[0].c_str(), ctx0[0], cmd);
+                ex.extract(model.contextnet_out[1].c_str(), ctx0[1], cmd);
+                ex.extract(model.contextnet_out[2].c_str(), ctx0[2], cmd);
+                ex.extract(model.contextnet_out[3].c_str(), ctx0[3], cmd);
             }
             {
                 ncnn::Extractor ex = contextnet.create_extractor();
@@ -679,19 +1061,19 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                 ex.set_workspace_vkallocator(blob_vkallocator);
                 ex.set_staging_vkallocator(staging_vkallocator);
 
-                ex.input("input.1", in1_gpu_padded[ti]);
+                ex.input(model.contextnet_in.c_str(), in1_gpu_padded[ti]);
                 if (rife_v2)
                 {
-                    ex.input("flow.0", flow1[ti]);
+                    ex.input(model.contextnet_flow1.c_str(), flow1[ti]);
                 }
                 else
                 {
-                    ex.input("flow.1", flow[ti]);
+                    ex.input(model.contextnet_flow1.c_str(), flow[ti]);
                 }
-                ex.extract("f1", ctx1[0], cmd);
-                ex.extract("f2", ctx1[1], cmd);
-                ex.extract("f3", ctx1[2], cmd);
-                ex.extract("f4", ctx1[3], cmd);
+                ex.extract(model.contextnet_out[0].c_str(), ctx1[0], cmd);
+                ex.extract(model.contextnet_out[1].c_str(), ctx1[1], cmd);
+                ex.extract(model.contextnet_out[2].c_str(), ctx1[2], cmd);
+                ex.extract(model.contextnet_out[3].c_str(), ctx1[3], cmd);
             }
 
             // fusionnet
@@ -701,17 +1083,17 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                 ex.set_workspace_vkallocator(blob_vkallocator);
                 ex.set_staging_vkallocator(staging_vkallocator);
 
-                ex.input("img0", in0_gpu_padded[ti]);
-                ex.input("img1", in1_gpu_padded[ti]);
-                ex.input("flow", flow[ti]);
-                ex.input("3", ctx0[0]);
-                ex.input("4", ctx0[1]);
-                ex.input("5", ctx0[2]);
-                ex.input("6", ctx0[3]);
-                ex.input("7", ctx1[0]);
-                ex.input("8", ctx1[1]);
-                ex.input("9", ctx1[2]);
-                ex.input("10", ctx1[3]);
+                ex.input(model.fusionnet_in0.c_str(), in0_gpu_padded[ti]);
+                ex.input(model.fusionnet_in1.c_str(), in1_gpu_padded[ti]);
+                ex.input(model.fusionnet_flow.c_str(), flow[ti]);
+                ex.input(model.fusionnet_ctx0[0].c_str(), ctx0[0]);
+                ex.input(model.fusionnet_ctx0[1].c_str(), ctx0[1]);
+                ex.input(model.fusionnet_ctx0[2].c_str(), ctx0[2]);
+                ex.input(model.fusionnet_ctx0[3].c_str(), ctx0[3]);
+                ex.input(model.fusionnet_ctx1[0].c_str(), ctx1[0]);
+                ex.input(model.fusionnet_ctx1[1].c_str(), ctx1[1]);
+                ex.input(model.fusionnet_ctx1[2].c_str(), ctx1[2]);
+                ex.input(model.fusionnet_ctx1[3].c_str(), ctx1[3]);
 
                 // save some memory
                 if (!tta_temporal_mode)
@@ -740,7 +1122,7 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                     flow[ti - 1].release();
                 }
 
-                ex.extract("output", out_gpu_padded[ti], cmd);
+                ex.extract(model.fusionnet_out.c_str(), out_gpu_padded[ti], cmd);
             }
 
             if (tta_temporal_mode)
@@ -753,17 +1135,17 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                     ex.set_workspace_vkallocator(blob_vkallocator);
                     ex.set_staging_vkallocator(staging_vkallocator);
 
-                    ex.input("img0", in1_gpu_padded[ti]);
-                    ex.input("img1", in0_gpu_padded[ti]);
-                    ex.input("flow", flow_reversed[ti]);
-                    ex.input("3", ctx1[0]);
-                    ex.input("4", ctx1[1]);
-                    ex.input("5", ctx1[2]);
-                    ex.input("6", ctx1[3]);
-                    ex.input("7", ctx0[0]);
-                    ex.input("8", ctx0[1]);
-                    ex.input("9", ctx0[2]);
-                    ex.input("10", ctx0[3]);
+                    ex.input(model.fusionnet_in0.c_str(), in1_gpu_padded[ti]);
+                    ex.input(model.fusionnet_in1.c_str(), in0_gpu_padded[ti]);
+                    ex.input(model.fusionnet_flow.c_str(), flow_reversed[ti]);
+                    ex.input(model.fusionnet_ctx0[0].c_str(), ctx1[0]);
+                    ex.input(model.fusionnet_ctx0[1].c_str(), ctx1[1]);
+                    ex.input(model.fusionnet_ctx0[2].c_str(), ctx1[2]);
+                    ex.input(model.fusionnet_ctx0[3].c_str(), ctx1[3]);
+                    ex.input(model.fusionnet_ctx1[0].c_str(), ctx0[0]);
+                    ex.input(model.fusionnet_ctx1[1].c_str(), ctx0[1]);
+                    ex.input(model.fusionnet_ctx1[2].c_str(), ctx0[2]);
+                    ex.input(model.fusionnet_ctx1[3].c_str(), ctx0[3]);
 
                     // save some memory
                     if (ti == 0)
@@ -786,7 +1168,7 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                     ctx1[2].release();
                     ctx1[3].release();
 
-                    ex.extract("output", out_gpu_padded_reversed, cmd);
+                    ex.extract(model.fusionnet_out.c_str(), out_gpu_padded_reversed, cmd);
                 }
 
                 // merge output
@@ -804,7 +1186,7 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                     dispatcher.w = out_gpu_padded[ti].w;
                     dispatcher.h = out_gpu_padded[ti].h;
                     dispatcher.c = 3;
-                    cmd.record_pipeline(rife_out_tta_temporal_avg, bindings, constants, dispatcher);
+                    cmd.record_pipeline(rife_out_tta_temporal_avg->get(constants), bindings, constants, dispatcher);
                 }
             }
         }
@@ -832,7 +1214,7 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             constants[4].i = out_gpu.h;
             constants[5].i = out_gpu.cstep;
 
-            cmd.record_pipeline(rife_postproc, bindings, constants, out_gpu);
+            cmd.record_pipeline(rife_postproc->get(constants), bindings, constants, out_gpu);
         }
     }
     else
@@ -840,45 +1222,104 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
         // preproc
         ncnn::VkMat in0_gpu_padded;
         ncnn::VkMat in1_gpu_padded;
+        ncnn::VkMat in0_gpu_padded_downscaled;
+        ncnn::VkMat in1_gpu_padded_downscaled;
         {
             in0_gpu_padded.create(w_padded, h_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
 
-            std::vector<ncnn::VkMat> bindings(2);
-            bindings[0] = in0_gpu;
-            bindings[1] = in0_gpu_padded;
-
-            std::vector<ncnn::vk_constant_type> constants(6);
-            constants[0].i = in0_gpu.w;
-            constants[1].i = in0_gpu.h;
-            constants[2].i = in0_gpu.cstep;
-            constants[3].i = in0_gpu_padded.w;
-            constants[4].i = in0_gpu_padded.h;
-            constants[5].i = in0_gpu_padded.cstep;
-
-            cmd.record_pipeline(rife_preproc, bindings, constants, in0_gpu_padded);
+            if (uhd_mode)
+            {
+                in0_gpu_padded_downscaled.create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+
+                std::vector<ncnn::VkMat> bindings(3);
+                bindings[0] = in0_gpu;
+                bindings[1] = in0_gpu_padded;
+                bindings[2] = in0_gpu_padded_downscaled;
+
+                std::vector<ncnn::vk_constant_type> constants(9);
+                constants[0].i = in0_gpu.w;
+                constants[1].i = in0_gpu.h;
+                constants[2].i = in0_gpu.cstep;
+                constants[3].i = in0_gpu_padded.w;
+                constants[4].i = in0_gpu_padded.h;
+                constants[5].i = in0_gpu_padded.cstep;
+                constants[6].i = in0_gpu_padded_downscaled.w;
+                constants[7].i = in0_gpu_padded_downscaled.h;
+                constants[8].i = in0_gpu_padded_downscaled.cstep;
+
+                // one invocation per 2x2 block
+                cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, in0_gpu_padded_downscaled);
+            }
+            else
+            {
+                std::vector<ncnn::VkMat> bindings(2);
+                bindings[0] = in0_gpu;
+                bindings[1] = in0_gpu_padded;
+
+                std::vector<ncnn::vk_constant_type> constants(6);
+                constants[0].i = in0_gpu.w;
+                constants[1].i = in0_gpu.h;
+                constants[2].i = in0_gpu.cstep;
+                constants[3].i = in0_gpu_padded.w;
+                constants[4].i = in0_gpu_padded.h;
+                constants[5].i = in0_gpu_padded.cstep;
+
+                cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, in0_gpu_padded);
+            }
         }
         {
             in1_gpu_padded.create(w_padded, h_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
 
-            std::vector<ncnn::VkMat> bindings(2);
-            bindings[0] = in1_gpu;
-            bindings[1] = in1_gpu_padded;
-
-            std::vector<ncnn::vk_constant_type> constants(6);
-            constants[0].i = in1_gpu.w;
-            constants[1].i = in1_gpu.h;
-            constants[2].i = in1_gpu.cstep;
-            constants[3].i = in1_gpu_padded.w;
-            constants[4].i = in1_gpu_padded.h;
-            constants[5].i = in1_gpu_padded.cstep;
-
-            cmd.record_pipeline(rife_preproc, bindings, constants, in1_gpu_padded);
+            if (uhd_mode)
+            {
+                in1_gpu_padded_downscaled.create(w_padded / 2, h_padded / 2, 3, in_out_tile_elemsize, 1, blob_vkallocator);
+
+                std::vector<ncnn::VkMat> bindings(3);
+                bindings[0] = in1_gpu;
+                bindings[1] = in1_gpu_padded;
+                bindings[2] = in1_gpu_padded_downscaled;
+
+                std::vector<ncnn::vk_constant_type> constants(9);
+                constants[0].i = in1_gpu.w;
+                constants[1].i = in1_gpu.h;
+                constants[2].i = in1_gpu.cstep;
+                constants[3].i = in1_gpu_padded.w;
+                constants[4].i = in1_gpu_padded.h;
+                constants[5].i = in1_gpu_padded.cstep;
+                constants[6].i = in1_gpu_padded_downscaled.w;
+                constants[7].i = in1_gpu_padded_downscaled.h;
+                constants[8].i = in1_gpu_padded_downscaled.cstep;
+
+                // one invocation per 2x2 block
+                cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, in1_gpu_padded_downscaled);
+            }
+            else
+            {
+                std::vector<ncnn::VkMat> bindings(2);
+                bindings[0] = in1_gpu;
+                bindings[1] = in1_gpu_padded;
+
+                std::vector<ncnn::vk_constant_type> constants(6);
+                constants[0].i = in1_gpu.w;
+                constants[1].i = in1_gpu.h;
+                constants[2].i = in1_gpu.cstep;
+                constants[3].i = in1_gpu_padded.w;
+                constants[4].i = in1_gpu_padded.h;
+                constants[5].i = in1_gpu_padded.cstep;
+
+                cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, in1_gpu_padded);
+            }
         }
 
-        // flownet
+        // flownet, unless the flow was estimated before
         ncnn::VkMat flow;
         ncnn::VkMat flow0;
         ncnn::VkMat flow1;
+        if (flow_in)
+        {
+            flow = *flow_in;
+        }
+        else
         {
             ncnn::Extractor ex = flownet.create_extractor();
             ex.set_blob_vkallocator(blob_vkallocator);
@@ -887,27 +1328,19 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
 
             if (uhd_mode)
             {
-                ncnn::VkMat in0_gpu_padded_downscaled;
-                ncnn::VkMat in1_gpu_padded_downscaled;
-                rife_uhd_downscale_image->forward(in0_gpu_padded, in0_gpu_padded_downscaled, cmd, opt);
-                rife_uhd_downscale_image->forward(in1_gpu_padded, in1_gpu_padded_downscaled, cmd, opt);
-
-                ex.input("input0", in0_gpu_padded_downscaled);
-                ex.input("input1", in1_gpu_padded_downscaled);
+                ex.input(model.flownet_in0.c_str(), in0_gpu_padded_downscaled);
+                ex.input(model.flownet_in1.c_str(), in1_gpu_padded_downscaled);
 
                 ncnn::VkMat flow_downscaled;
-                ex.extract("flow", flow_downscaled, cmd);
+                ex.extract(model.flownet_out.c_str(), flow_downscaled, cmd);
 
-                ncnn::VkMat flow_half;
-                rife_uhd_upscale_flow->forward(flow_downscaled, flow_half, cmd, opt);
-
-                rife_uhd_double_flow->forward(flow_half, flow, cmd, opt);
+                upscale_uhd_flow(flow_downscaled, flow, cmd, opt);
             }
             else
             {
-                ex.input("input0", in0_gpu_padded);
-                ex.input("input1", in1_gpu_padded);
-                ex.extract("flow", flow, cmd);
+                ex.input(model.flownet_in0.c_str(), in0_gpu_padded);
+                ex.input(model.flownet_in1.c_str(), in1_gpu_padded);
+                ex.extract(model.flownet_out.c_str(), flow, cmd);
             }
         }
 
@@ -922,27 +1355,19 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
 
             if (uhd_mode)
             {
-                ncnn::VkMat in0_gpu_padded_downscaled;
-                ncnn::VkMat in1_gpu_padded_downscaled;
-                rife_uhd_downscale_image->forward(in0_gpu_padded, in0_gpu_padded_downscaled, cmd, opt);
-                rife_uhd_downscale_image->forward(in1_gpu_padded, in1_gpu_padded_downscaled, cmd, opt);
-
-                ex.input("input0", in1_gpu_padded_downscaled);
-                ex.input("input1", in0_gpu_padded_downscaled);
+                ex.input(model.flownet_in0.c_str(), in1_gpu_padded_downscaled);
+                ex.input(model.flownet_in1.c_str(), in0_gpu_padded_downscaled);
 
                 ncnn::VkMat flow_downscaled;
-                ex.extract("flow", flow_downscaled, cmd);
-
-                ncnn::VkMat flow_half;
-                rife_uhd_upscale_flow->forward(flow_downscaled, flow_half, cmd, opt);
+                ex.extract(model.flownet_out.c_str(), flow_downscaled, cmd);
 
-                rife_uhd_double_flow->forward(flow_half, flow_reversed, cmd, opt);
+                upscale_uhd_flow(flow_downscaled, flow_reversed, cmd, opt);
             }
             else
             {
-                ex.input("input0", in1_gpu_padded);
-                ex.input("input1", in0_gpu_padded);
-                ex.extract("flow", flow_reversed, cmd);
+                ex.input(model.flownet_in0.c_str(), in1_gpu_padded);
+                ex.input(model.flownet_in1.c_str(), in0_gpu_padded);
+                ex.extract(model.flownet_out.c_str(), flow_reversed, cmd);
             }
 
             // merge flow and flow_reversed
@@ -961,10 +1386,17 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                 dispatcher.h = flow.h;
                 dispatcher.c = 1;
 
-                cmd.record_pipeline(rife_flow_tta_temporal_avg, bindings, constants, dispatcher);
+                cmd.record_pipeline(rife_flow_tta_temporal_avg->get(constants), bindings, constants, dispatcher);
             }
         }
 
+        // the half resolution frames are only read by flownet
+        in0_gpu_padded_downscaled.release();
+        in1_gpu_padded_downscaled.release();
+
+        if (flow_out)
+            *flow_out = flow;
+
         if (rife_v2)
         {
             std::vector<ncnn::VkMat> inputs(1);
@@ -984,19 +1416,19 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             ex.set_workspace_vkallocator(blob_vkallocator);
             ex.set_staging_vkallocator(staging_vkallocator);
 
-            ex.input("input.1", in0_gpu_padded);
+            ex.input(model.contextnet_in.c_str(), in0_gpu_padded);
             if (rife_v2)
             {
-                ex.input("flow.0", flow0);
+                ex.input(model.contextnet_flow0.c_str(), flow0);
             }
             else
             {
-                ex.input("flow.0", flow);
+                ex.input(model.contextnet_flow0.c_str(), flow);
             }
-            ex.extract("f1", ctx0[0], cmd);
-            ex.extract("f2", ctx0[1], cmd);
-            ex.extract("f3", ctx0[2], cmd);
-            ex.extract("f4", ctx0[3], cmd);
+            ex.extract(model.contextnet_out[0].c_str(), ctx0[0], cmd);
+            ex.extract(model.contextnet_out[1].c_str(), ctx0[1], cmd);
+            ex.extract(model.contextnet_out[2].c_str(), ctx0[2], cmd);
+            ex.extract(model.contextnet_out[3].c_str(), ctx0[3], cmd);
         }
         {
             ncnn::Extractor ex = contextnet.create_extractor();
@@ -1004,19 +1436,19 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             ex.set_workspace_vkallocator(blob_vkallocator);
             ex.set_staging_vkallocator(staging_vkallocator);
 
-            ex.input("input.1", in1_gpu_padded);
+            ex.input(model.contextnet_in.c_str(), in1_gpu_padded);
             if (rife_v2)
             {
-                ex.input("flow.0", flow1);
+                ex.input(model.contextnet_flow1.c_str(), flow1);
             }
             else
             {
-                ex.input("flow.1", flow);
+                ex.input(model.contextnet_flow1.c_str(), flow);
             }
-            ex.extract("f1", ctx1[0], cmd);
-            ex.extract("f2", ctx1[1], cmd);
-            ex.extract("f3", ctx1[2], cmd);
-            ex.extract("f4", ctx1[3], cmd);
+            ex.extract(model.contextnet_out[0].c_str(), ctx1[0], cmd);
+            ex.extract(model.contextnet_out[1].c_str(), ctx1[1], cmd);
+            ex.extract(model.contextnet_out[2].c_str(), ctx1[2], cmd);
+            ex.extract(model.contextnet_out[3].c_str(), ctx1[3], cmd);
         }
 
         // fusionnet
@@ -1027,17 +1459,17 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             ex.set_workspace_vkallocator(blob_vkallocator);
             ex.set_staging_vkallocator(staging_vkallocator);
 
-            ex.input("img0", in0_gpu_padded);
-            ex.input("img1", in1_gpu_padded);
-            ex.input("flow", flow);
-            ex.input("3", ctx0[0]);
-            ex.input("4", ctx0[1]);
-            ex.input("5", ctx0[2]);
-            ex.input("6", ctx0[3]);
-            ex.input("7", ctx1[0]);
-            ex.input("8", ctx1[1]);
-            ex.input("9", ctx1[2]);
-            ex.input("10", ctx1[3]);
+            ex.input(model.fusionnet_in0.c_str(), in0_gpu_padded);
+            ex.input(model.fusionnet_in1.c_str(), in1_gpu_padded);
+            ex.input(model.fusionnet_flow.c_str(), flow);
+            ex.input(model.fusionnet_ctx0[0].c_str(), ctx0[0]);
+            ex.input(model.fusionnet_ctx0[1].c_str(), ctx0[1]);
+            ex.input(model.fusionnet_ctx0[2].c_str(), ctx0[2]);
+            ex.input(model.fusionnet_ctx0[3].c_str(), ctx0[3]);
+            ex.input(model.fusionnet_ctx1[0].c_str(), ctx1[0]);
+            ex.input(model.fusionnet_ctx1[1].c_str(), ctx1[1]);
+            ex.input(model.fusionnet_ctx1[2].c_str(), ctx1[2]);
+            ex.input(model.fusionnet_ctx1[3].c_str(), ctx1[3]);
 
             if (!tta_temporal_mode)
             {
@@ -1055,7 +1487,7 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             }
             flow.release();
 
-            ex.extract("output", out_gpu_padded, cmd);
+            ex.extract(model.fusionnet_out.c_str(), out_gpu_padded, cmd);
         }
 
         if (tta_temporal_mode)
@@ -1068,17 +1500,17 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                 ex.set_workspace_vkallocator(blob_vkallocator);
                 ex.set_staging_vkallocator(staging_vkallocator);
 
-                ex.input("img0", in1_gpu_padded);
-                ex.input("img1", in0_gpu_padded);
-                ex.input("flow", flow_reversed);
-                ex.input("3", ctx1[0]);
-                ex.input("4", ctx1[1]);
-                ex.input("5", ctx1[2]);
-                ex.input("6", ctx1[3]);
-                ex.input("7", ctx0[0]);
-                ex.input("8", ctx0[1]);
-                ex.input("9", ctx0[2]);
-                ex.input("10", ctx0[3]);
+                ex.input(model.fusionnet_in0.c_str(), in1_gpu_padded);
+                ex.input(model.fusionnet_in1.c_str(), in0_gpu_padded);
+                ex.input(model.fusionnet_flow.c_str(), flow_reversed);
+                ex.input(model.fusionnet_ctx0[0].c_str(), ctx1[0]);
+                ex.input(model.fusionnet_ctx0[1].c_str(), ctx1[1]);
+                ex.input(model.fusionnet_ctx0[2].c_str(), ctx1[2]);
+                ex.input(model.fusionnet_ctx0[3].c_str(), ctx1[3]);
+                ex.input(model.fusionnet_ctx1[0].c_str(), ctx0[0]);
+                ex.input(model.fusionnet_ctx1[1].c_str(), ctx0[1]);
+                ex.input(model.fusionnet_ctx1[2].c_str(), ctx0[2]);
+                ex.input(model.fusionnet_ctx1[3].c_str(), ctx0[3]);
 
                 // save some memory
                 in0_gpu.release();
@@ -1093,7 +1525,7 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                 ctx1[3].release();
                 flow_reversed.release();
 
-                ex.extract("output", out_gpu_padded_reversed, cmd);
+                ex.extract(model.fusionnet_out.c_str(), out_gpu_padded_reversed, cmd);
             }
 
             // merge output
@@ -1111,7 +1543,7 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
                 dispatcher.w = out_gpu_padded.w;
                 dispatcher.h = out_gpu_padded.h;
                 dispatcher.c = 3;
-                cmd.record_pipeline(rife_out_tta_temporal_avg, bindings, constants, dispatcher);
+                cmd.record_pipeline(rife_out_tta_temporal_avg->get(constants), bindings, constants, dispatcher);
             }
         }
 
@@ -1131,34 +1563,9 @@ int RIFE::process(const float* src0R, const float* src0G, const float* src0B,
             constants[4].i = out_gpu.h;
             constants[5].i = out_gpu.cstep;
 
-            cmd.record_pipeline(rife_postproc, bindings, constants, out_gpu);
-        }
-    }
-
-    // download
-    {
-        ncnn::Mat out;
-
-        cmd.record_clone(out_gpu, out, opt);
-
-        cmd.submit_and_wait();
-
-        const float* outR{ out.channel(0) };
-        const float* outG{ out.channel(1) };
-        const float* outB{ out.channel(2) };
-        for (auto y{ 0 }; y < h; y++) {
-            for (auto x{ 0 }; x < w; x++) {
-                dstR[stride * y + x] = outR[w * y + x] * (1 / 255.0f);
-                dstG[stride * y + x] = outG[w * y + x] * (1 / 255.0f);
-                dstB[stride * y + x] = outB[w * y + x] * (1 / 255.0f);
-            }
+            cmd.record_pipeline(rife_postproc->get(constants), bindings, constants, out_gpu);
         }
     }
-
-    vkdev->reclaim_blob_allocator(blob_vkallocator);
-    vkdev->reclaim_staging_allocator(staging_vkallocator);
-
-    return 0;
 }
 
 int RIFE::process_v4(const float* src0R, const float* src0G, const float* src0B,
@@ -1166,6 +1573,8 @@ int RIFE::process_v4(const float* src0R, const float* src0G, const float* src0B,
                      float* dstR, float* dstG, float* dstB,
                      const int w, const int h, const ptrdiff_t stride, const float timestep) const
 {
+    SpecializedPipeline::Use use;
+
     const int channels = 3;//in0image.elempack;
 
 //     fprintf(stderr, "%d x %d\n", w, h);
@@ -1178,9 +1587,9 @@ int RIFE::process_v4(const float* src0R, const float* src0G, const float* src0B,
     opt.workspace_vkallocator = blob_vkallocator;
     opt.staging_vkallocator = staging_vkallocator;
 
-    // pad to 32n
-    int w_padded = (w + 31) / 32 * 32;
-    int h_padded = (h + 31) / 32 * 32;
+    // pad to the granularity the model needs
+    int w_padded = (w + model.padding - 1) / model.padding * model.padding;
+    int h_padded = (h + model.padding - 1) / model.padding * model.padding;
 
     const size_t in_out_tile_elemsize = opt.use_fp16_storage ? 2u : 4u;
 
@@ -1237,7 +1646,7 @@ int RIFE::process_v4(const float* src0R, const float* src0G, const float* src0B,
             constants[4].i = in0_gpu_padded.h;
             constants[5].i = in0_gpu_padded.cstep;
 
-            cmd.record_pipeline(rife_preproc, bindings, constants, in0_gpu_padded);
+            cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, in0_gpu_padded);
         }
         {
             in1_gpu_padded.create(w_padded, h_padded, 3, in_out_tile_elemsize, 1, blob_vkallocator);
@@ -1254,8 +1663,9 @@ int RIFE::process_v4(const float* src0R, const float* src0G, const float* src0B,
             constants[4].i = in1_gpu_padded.h;
             constants[5].i = in1_gpu_padded.cstep;
 
-            cmd.record_pipeline(rife_preproc, bindings, constants, in1_gpu_padded);
+            cmd.record_pipeline(rife_preproc->get(constants), bindings, constants, in1_gpu_padded);
         }
+        if (model.timestep)
         {
             timestep_gpu_padded.create(w_padded, h_padded, 1, in_out_tile_elemsize, 1, blob_vkallocator);
 
@@ -1268,7 +1678,7 @@ int RIFE::process_v4(const float* src0R, const float* src0G, const float* src0B,
             constants[2].i = timestep_gpu_padded.cstep;
             constants[3].f = timestep;
 
-            cmd.record_pipeline(rife_v4_timestep, bindings, constants, timestep_gpu_padded);
+            cmd.record_pipeline(rife_v4_timestep->get(constants), bindings, constants, timestep_gpu_padded);
         }
 
         // flownet
@@ -1279,10 +1689,42 @@ int RIFE::process_v4(const float* src0R, const float* src0G, const float* src0B,
             ex.set_workspace_vkallocator(blob_vkallocator);
             ex.set_staging_vkallocator(staging_vkallocator);
 
-            ex.input("in0", in0_gpu_padded);
-            ex.input("in1", in1_gpu_padded);
-            ex.input("in2", timestep_gpu_padded);
-            ex.extract("out0", out_gpu_padded, cmd);
+            for (size_t i = 0; i < flownet_inputs.size(); i++)
+            {
+                const RIFEFlownetInput& input = flownet_inputs[i];
+
+                std::vector<ncnn::VkMat> inputs;
+                if (input.in0)
+                    inputs.push_back(in0_gpu_padded);
+                if (input.in1)
+                    inputs.push_back(in1_gpu_padded);
+                if (input.timestep)
+                    inputs.push_back(timestep_gpu_padded);
+
+                if (inputs.empty())
+                {
+                    ncnn::Mat scale(1);
+                    scale[0] = input.scale;
+
+                    ncnn::VkMat scale_gpu;
+                    cmd.record_upload(scale, scale_gpu, opt);
+
+                    ex.input(input.blob.c_str(), scale_gpu);
+                }
+                else if (inputs.size() == 1)
+                {
+                    ex.input(input.blob.c_str(), inputs[0]);
+                }
+                else
+                {
+                    std::vector<ncnn::VkMat> outputs(1);
+                    rife_v4_concat->forward(inputs, outputs, cmd, opt);
+
+                    ex.input(input.blob.c_str(), outputs[0]);
+                }
+            }
+
+            ex.extract(model.flownet_out.c_str(), out_gpu_padded, cmd);
         }
 
         out_gpu.create(w, h, channels, sizeof(float), 1, blob_vkallocator);
@@ -1301,7 +1743,7 @@ int RIFE::process_v4(const float* src0R, const float* src0G, const float* src0B,
             constants[4].i = out_gpu.h;
             constants[5].i = out_gpu.cstep;
 
-            cmd.record_pipeline(rife_postproc, bindings, constants, out_gpu);
+            cmd.record_pipeline(rife_postproc->get(constants), bindings, constants, out_gpu);
         }
     }
 
@@ -3,54 +3,104 @@
 #ifndef RIFE_H
 #define RIFE_H
 
+#include <functional>
 #include <string>
+#include <vector>
 
 // ncnn
 #include "net.h"
 
+#include "mapped_file.h"
+#include "rife_model.h"
+#include "rife_pipeline.h"
+#include "rife_tuning.h"
+
 class RIFE
 {
 public:
-    RIFE(int gpuid, bool tta_mode = false, bool uhd_mode = false, int num_threads = 1, bool rife_v2 = false, bool rife_v4 = false);
+    RIFE(int gpuid, const RIFEModelInfo& model, bool tta_mode = false, bool uhd_mode = false, int num_threads = 1, bool optimize = false);
     ~RIFE();
 
+    // takes effect on the next load
+    void set_tuning(const RIFETuning& tuning);
+
 #if _WIN32
     int load(const std::wstring& modeldir);
 #else
     int load(const std::string& modeldir);
 #endif
 
+#ifdef RIFE_EMBEDDED_MODELS
+    // load a model directory that was compiled into the module, e.g. "rife-v4"
+    int load_embedded(const std::string& modelname);
+#endif
+
     int process(const float* src0R, const float* src0G, const float* src0B,
                 const float* src1R, const float* src1G, const float* src1B,
                 float* dstR, float* dstG, float* dstB,
                 const int w, const int h, const ptrdiff_t stride, const float timestep) const;
 
+    // Interpolates several timesteps of one pair, the frames are uploaded once. Models without a
+    // timestep input bisect, each midpoint is computed once, kept on the gpu and shared by the
+    // timesteps below it, which are rounded to the nearest multiple of 1/32. Given flow_out, models
+    // without a timestep input also return the flow flownet estimated from the midpoint of the pair
+    // to its frames, w x h with a channel per component, in pixels. Given flow_in in that layout,
+    // flownet is skipped for the midpoint and the flow is used in its place, except in tta mode.
+    int process_multi(const float* src0R, const float* src0G, const float* src0B,
+                      const float* src1R, const float* src1G, const float* src1B,
+                      float* const* dstR, float* const* dstG, float* const* dstB, const float* timesteps, const int count,
+                      const int w, const int h, const ptrdiff_t stride, ncnn::Mat* flow_out = 0, const ncnn::Mat* flow_in = 0) const;
+
     int process_v4(const float* src0R, const float* src0G, const float* src0B,
                    const float* src1R, const float* src1G, const float* src1B,
                    float* dstR, float* dstG, float* dstB,
                    const int w, const int h, const ptrdiff_t stride, const float timestep) const;
 
+private:
+    // memory a net references its weights from, as long as it is alive
+    struct NetStorage
+    {
+        MappedFile mapping;
+    };
+
+    int load(const std::function<int(ncnn::Net&, NetStorage&, const char*)>& load_net);
+    int load_net_mem(ncnn::Net& net, const char* name, const char* param, const unsigned char* bin) const;
+    int resolve_v4_inputs();
+    // one midpoint of two frames in the layout they are uploaded in, releases the inputs as soon as
+    // they are no longer needed, flow_out receives the padded flow, a padded flow_in replaces flownet
+    // outside tta mode
+    void interpolate_gpu(ncnn::VkMat& in0_gpu, ncnn::VkMat& in1_gpu, ncnn::VkMat& out_gpu, ncnn::VkCompute& cmd, const ncnn::Option& opt,
+                         ncnn::VkMat* flow_out = 0, const ncnn::VkMat* flow_in = 0) const;
+    void upscale_uhd_flow(const ncnn::VkMat& flow_downscaled, ncnn::VkMat& flow, ncnn::VkCompute& cmd, const ncnn::Option& opt) const;
+
 private:
     ncnn::VulkanDevice* vkdev;
+    NetStorage flownet_model;
+    NetStorage contextnet_model;
+    NetStorage fusionnet_model;
     ncnn::Net flownet;
     ncnn::Net contextnet;
     ncnn::Net fusionnet;
-    ncnn::Pipeline* rife_preproc;
-    ncnn::Pipeline* rife_postproc;
-    ncnn::Pipeline* rife_flow_tta_avg;
-    ncnn::Pipeline* rife_flow_tta_temporal_avg;
-    ncnn::Pipeline* rife_out_tta_temporal_avg;
-    ncnn::Pipeline* rife_v4_timestep;
-    ncnn::Layer* rife_uhd_downscale_image;
-    ncnn::Layer* rife_uhd_upscale_flow;
-    ncnn::Layer* rife_uhd_double_flow;
+    SpecializedPipeline* rife_preproc;
+    SpecializedPipeline* rife_postproc;
+    SpecializedPipeline* rife_flow_tta_avg;
+    SpecializedPipeline* rife_flow_tta_temporal_avg;
+    SpecializedPipeline* rife_out_tta_temporal_avg;
+    SpecializedPipeline* rife_v4_timestep;
+    SpecializedPipeline* rife_uhd_flow;
+    SpecializedPipeline* rife_uhd_flow_pack4;
     ncnn::Layer* rife_v2_slice_flow;
+    ncnn::Layer* rife_v4_concat;
+    std::vector<RIFEFlownetInput> flownet_inputs;
     bool tta_mode;
     bool tta_temporal_mode;
     bool uhd_mode;
     int num_threads;
+    bool optimize;
+    RIFETuning tuning;
     bool rife_v2;
     bool rife_v4;
+    RIFEModelInfo model;
 };
 
 #endif // RIFE_H
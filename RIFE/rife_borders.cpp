@@ -0,0 +1,149 @@
+// rife implemented with ncnn library
+
+#include "rife_borders.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RIFE_BORDERS_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RIFE_BORDERS_NEON 1
+#endif
+
+// whether every sample of [x0, x1) in the three rows is at most threshold, 16 samples of a plane
+// are tested per step so the bars are scanned at memory speed
+static bool is_black(const float* r, const float* g, const float* b, int x0, int x1, float threshold)
+{
+    int x = x0;
+
+#if RIFE_BORDERS_SSE2
+    const __m128 t = _mm_set1_ps(threshold);
+    for (; x + 16 <= x1; x += 16)
+    {
+        __m128 m0 = _mm_max_ps(_mm_max_ps(_mm_loadu_ps(r + x), _mm_loadu_ps(g + x)), _mm_loadu_ps(b + x));
+        __m128 m1 = _mm_max_ps(_mm_max_ps(_mm_loadu_ps(r + x + 4), _mm_loadu_ps(g + x + 4)), _mm_loadu_ps(b + x + 4));
+        __m128 m2 = _mm_max_ps(_mm_max_ps(_mm_loadu_ps(r + x + 8), _mm_loadu_ps(g + x + 8)), _mm_loadu_ps(b + x + 8));
+        __m128 m3 = _mm_max_ps(_mm_max_ps(_mm_loadu_ps(r + x + 12), _mm_loadu_ps(g + x + 12)), _mm_loadu_ps(b + x + 12));
+        __m128 m = _mm_max_ps(_mm_max_ps(m0, m1), _mm_max_ps(m2, m3));
+        if (_mm_movemask_ps(_mm_cmpgt_ps(m, t)))
+            return false;
+    }
+    for (; x + 4 <= x1; x += 4)
+    {
+        __m128 m = _mm_max_ps(_mm_max_ps(_mm_loadu_ps(r + x), _mm_loadu_ps(g + x)), _mm_loadu_ps(b + x));
+        if (_mm_movemask_ps(_mm_cmpgt_ps(m, t)))
+            return false;
+    }
+#elif RIFE_BORDERS_NEON
+    const float32x4_t t = vdupq_n_f32(threshold);
+    for (; x + 16 <= x1; x += 16)
+    {
+        float32x4_t m0 = vmaxq_f32(vmaxq_f32(vld1q_f32(r + x), vld1q_f32(g + x)), vld1q_f32(b + x));
+        float32x4_t m1 = vmaxq_f32(vmaxq_f32(vld1q_f32(r + x + 4), vld1q_f32(g + x + 4)), vld1q_f32(b + x + 4));
+        float32x4_t m2 = vmaxq_f32(vmaxq_f32(vld1q_f32(r + x + 8), vld1q_f32(g + x + 8)), vld1q_f32(b + x + 8));
+        float32x4_t m3 = vmaxq_f32(vmaxq_f32(vld1q_f32(r + x + 12), vld1q_f32(g + x + 12)), vld1q_f32(b + x + 12));
+        float32x4_t m = vmaxq_f32(vmaxq_f32(m0, m1), vmaxq_f32(m2, m3));
+        if (vmaxvq_u32(vcgtq_f32(m, t)))
+            return false;
+    }
+    for (; x + 4 <= x1; x += 4)
+    {
+        float32x4_t m = vmaxq_f32(vmaxq_f32(vld1q_f32(r + x), vld1q_f32(g + x)), vld1q_f32(b + x));
+        if (vmaxvq_u32(vcgtq_f32(m, t)))
+            return false;
+    }
+#endif
+
+    for (; x < x1; x++)
+    {
+        if (r[x] > threshold || g[x] > threshold || b[x] > threshold)
+            return false;
+    }
+
+    return true;
+}
+
+RIFERect rife_detect_active_area(const float* r, const float* g, const float* b, int w, int h, ptrdiff_t stride, float threshold)
+{
+    RIFERect area = {0, 0, 0, 0};
+
+    int top = 0;
+    while (top < h && is_black(r + top * stride, g + top * stride, b + top * stride, 0, w, threshold))
+        top++;
+
+    if (top == h)
+        return area;
+
+    int bottom = h;
+    while (bottom > top && is_black(r + (bottom - 1) * stride, g + (bottom - 1) * stride, b + (bottom - 1) * stride, 0, w, threshold))
+        bottom--;
+
+    // the columns only need to be scanned up to the widest picture found so far, a row whose bar
+    // part is black costs one vectorized pass over the bar
+    int left = w;
+    int right = 0;
+    for (int y = top; y < bottom && (left > 0 || right < w); y++)
+    {
+        const float* rr = r + y * stride;
+        const float* gg = g + y * stride;
+        const float* bb = b + y * stride;
+
+        if (!is_black(rr, gg, bb, 0, left, threshold))
+        {
+            int x = 0;
+            while (rr[x] <= threshold && gg[x] <= threshold && bb[x] <= threshold)
+                x++;
+            left = x;
+        }
+
+        if (!is_black(rr, gg, bb, std::max(right, left), w, threshold))
+        {
+            int x = w;
+            while (rr[x - 1] <= threshold && gg[x - 1] <= threshold && bb[x - 1] <= threshold)
+                x--;
+            right = x;
+        }
+    }
+
+    area.x = left;
+    area.y = top;
+    area.w = right - left;
+    area.h = bottom - top;
+    return area;
+}
+
+RIFERect rife_union_area(const RIFERect& a, const RIFERect& b)
+{
+    if (a.empty())
+        return b;
+
+    if (b.empty())
+        return a;
+
+    RIFERect area;
+    area.x = std::min(a.x, b.x);
+    area.y = std::min(a.y, b.y);
+    area.w = std::max(a.x + a.w, b.x + b.w) - area.x;
+    area.h = std::max(a.y + a.h, b.y + b.h) - area.y;
+    return area;
+}
+
+static void align_span(int& x, int& len, int size, int granularity)
+{
+    int aligned = std::min((len + granularity - 1) / granularity * granularity, size);
+    x = std::clamp(x - (aligned - len) / 2, 0, size - aligned);
+    len = aligned;
+}
+
+RIFERect rife_align_area(const RIFERect& area, int w, int h, int granularity)
+{
+    RIFERect aligned = area;
+    if (aligned.empty())
+        return aligned;
+
+    align_span(aligned.x, aligned.w, w, granularity);
+    align_span(aligned.y, aligned.h, h, granularity);
+    return aligned;
+}
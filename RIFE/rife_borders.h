@@ -0,0 +1,30 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_BORDERS_H
+#define RIFE_BORDERS_H
+
+#include <cstddef>
+
+// Rectangle of a frame, the active picture inside letterbox or pillarbox bars.
+struct RIFERect
+{
+    int x;
+    int y;
+    int w;
+    int h;
+
+    bool empty() const { return w <= 0 || h <= 0; }
+};
+
+// Finds the active picture of a planar RGB frame by scanning inward from each edge for rows and
+// columns whose samples are all at most threshold. The area is empty when the whole frame is black.
+RIFERect rife_detect_active_area(const float* r, const float* g, const float* b, int w, int h, ptrdiff_t stride, float threshold);
+
+// Smallest rectangle holding both, an empty area adds nothing.
+RIFERect rife_union_area(const RIFERect& a, const RIFERect& b);
+
+// Grows an area around its center to multiples of granularity, kept inside the w x h frame, so the
+// model pads nothing but picture and a clip settles on a few inference sizes.
+RIFERect rife_align_area(const RIFERect& area, int w, int h, int granularity);
+
+#endif // RIFE_BORDERS_H
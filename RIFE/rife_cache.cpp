@@ -0,0 +1,273 @@
+// rife implemented with ncnn library
+
+#include "rife_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// ncnn
+#include "mat.h"
+
+#include "mapped_file.h"
+
+static const uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t prime64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t prime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t prime64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * prime64_2;
+    acc = rotl64(acc, 31);
+    return acc * prime64_1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * prime64_1 + prime64_4;
+}
+
+uint64_t rife_hash(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+
+    uint64_t h;
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + prime64_1 + prime64_2;
+        uint64_t v2 = seed + prime64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime64_1;
+
+        for (; p + 32 <= end; p += 32)
+        {
+            v1 = xxh64_round(v1, read64(p));
+            v2 = xxh64_round(v2, read64(p + 8));
+            v3 = xxh64_round(v3, read64(p + 16));
+            v4 = xxh64_round(v4, read64(p + 24));
+        }
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64_merge(h, v1);
+        h = xxh64_merge(h, v2);
+        h = xxh64_merge(h, v3);
+        h = xxh64_merge(h, v4);
+    }
+    else
+    {
+        h = seed + prime64_5;
+    }
+
+    h += size;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= xxh64_round(0, read64(p));
+        h = rotl64(h, 27) * prime64_1 + prime64_4;
+    }
+
+    if (p + 4 <= end)
+    {
+        h ^= read32(p) * prime64_1;
+        h = rotl64(h, 23) * prime64_2 + prime64_3;
+        p += 4;
+    }
+
+    for (; p < end; p++)
+    {
+        h ^= *p * prime64_5;
+        h = rotl64(h, 11) * prime64_1;
+    }
+
+    h ^= h >> 33;
+    h *= prime64_2;
+    h ^= h >> 29;
+    h *= prime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t rife_hash_planes(const float* r, const float* g, const float* b, int w, int h, ptrdiff_t stride, uint64_t seed)
+{
+    const float* planes[3] = {r, g, b};
+    for (int c = 0; c < 3; c++)
+    {
+        for (int y = 0; y < h; y++)
+        {
+            seed = rife_hash(planes[c] + y * stride, w * sizeof(float), seed);
+        }
+    }
+
+    return seed;
+}
+
+static int process_id()
+{
+#if _WIN32
+    return _getpid();
+#else
+    return static_cast<int>(getpid());
+#endif
+}
+
+// layout of an entry, the three planes follow the header without padding
+struct FrameHeader
+{
+    char magic[8];
+    int32_t w;
+    int32_t h;
+    int32_t elemsize;
+    int32_t reserved;
+};
+
+static const char frame_magic[8] = {'R', 'I', 'F', 'E', 'F', 'R', 'M', '1'};
+
+RIFEFrameCache::RIFEFrameCache(const std::filesystem::path& _dir, bool _fp16)
+{
+    dir = _dir;
+    fp16 = _fp16;
+}
+
+std::filesystem::path RIFEFrameCache::path(const std::string& key) const
+{
+    return dir / key.substr(0, 2) / key;
+}
+
+int RIFEFrameCache::load(const std::string& key, float* r, float* g, float* b, int w, int h, ptrdiff_t stride) const
+{
+    MappedFile file;
+    if (file.open(path(key)) != 0 || file.size() < sizeof(FrameHeader))
+        return -1;
+
+    FrameHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, frame_magic, sizeof(frame_magic)) != 0 || header.w != w || header.h != h
+            || (header.elemsize != 2 && header.elemsize != 4))
+        return -1;
+
+    const size_t plane_size = static_cast<size_t>(w) * h * header.elemsize;
+    if (file.size() != sizeof(FrameHeader) + plane_size * 3)
+        return -1;
+
+    // an entry keeps the precision it was written with, whatever this cache writes
+    float* planes[3] = {r, g, b};
+    for (int c = 0; c < 3; c++)
+    {
+        const unsigned char* src = file.data() + sizeof(FrameHeader) + plane_size * c;
+        for (int y = 0; y < h; y++)
+        {
+            float* dst = planes[c] + y * stride;
+            if (header.elemsize == 4)
+            {
+                memcpy(dst, src + static_cast<size_t>(y) * w * 4, w * sizeof(float));
+                continue;
+            }
+
+            for (int x = 0; x < w; x++)
+            {
+                unsigned short v;
+                memcpy(&v, src + (static_cast<size_t>(y) * w + x) * 2, sizeof(v));
+                dst[x] = ncnn::float16_to_float32(v);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int RIFEFrameCache::save(const std::string& key, const float* r, const float* g, const float* b, int w, int h, ptrdiff_t stride) const
+{
+    const std::filesystem::path entrypath = path(key);
+
+    std::error_code ec;
+    std::filesystem::create_directories(entrypath.parent_path(), ec);
+
+    FrameHeader header;
+    memcpy(header.magic, frame_magic, sizeof(frame_magic));
+    header.w = w;
+    header.h = h;
+    header.elemsize = fp16 ? 2 : 4;
+    header.reserved = 0;
+
+    // threads finishing the same frame each write a file of their own and rename it over the entry, a
+    // reader never maps half of one. Thread ids repeat across processes sharing the directory, the
+    // process id tells their files apart.
+    std::filesystem::path tmppath = entrypath;
+    tmppath += ".tmp" + std::to_string(process_id()) + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream ofs(tmppath, std::ios::binary | std::ios::trunc);
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        const float* planes[3] = {r, g, b};
+        std::vector<unsigned short> row(fp16 ? w : 0);
+        for (int c = 0; c < 3; c++)
+        {
+            for (int y = 0; y < h; y++)
+            {
+                const float* src = planes[c] + y * stride;
+                if (!fp16)
+                {
+                    ofs.write(reinterpret_cast<const char*>(src), w * sizeof(float));
+                    continue;
+                }
+
+                for (int x = 0; x < w; x++)
+                {
+                    row[x] = ncnn::float32_to_float16(src[x]);
+                }
+                ofs.write(reinterpret_cast<const char*>(row.data()), w * sizeof(unsigned short));
+            }
+        }
+
+        if (!ofs.flush())
+        {
+            fprintf(stderr, "write %s failed\n", reinterpret_cast<const char*>(tmppath.u8string().c_str()));
+            ofs.close();
+            std::filesystem::remove(tmppath, ec);
+            return -1;
+        }
+    }
+
+    std::filesystem::rename(tmppath, entrypath, ec);
+    if (ec)
+    {
+        fprintf(stderr, "rename %s failed\n", reinterpret_cast<const char*>(tmppath.u8string().c_str()));
+        std::filesystem::remove(tmppath, ec);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_CACHE_H
+#define RIFE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// 64-bit XXH64 hash of a block of memory.
+uint64_t rife_hash(const void* data, size_t size, uint64_t seed);
+
+// Hash of a planar RGB frame, row by row so the padding past w is left out.
+uint64_t rife_hash_planes(const float* r, const float* g, const float* b, int w, int h, ptrdiff_t stride, uint64_t seed);
+
+// Interpolated frames on disk, one file per key under a directory of the first two characters of the
+// key. Keys address the content, a hash of everything the frame was interpolated from, so entries are
+// never invalidated, only added, and the directory can be deleted at any time to clear it. Entries
+// are read through a memory mapping. With fp16 the samples are stored as half floats, half the size
+// and exact to within 1/2048 of the 0..1 range.
+class RIFEFrameCache
+{
+public:
+    RIFEFrameCache(const std::filesystem::path& dir, bool fp16 = false);
+
+    // Returns -1 without touching the planes when there is no entry of that size for the key.
+    int load(const std::string& key, float* r, float* g, float* b, int w, int h, ptrdiff_t stride) const;
+
+    int save(const std::string& key, const float* r, const float* g, const float* b, int w, int h, ptrdiff_t stride) const;
+
+private:
+    std::filesystem::path path(const std::string& key) const;
+
+private:
+    std::filesystem::path dir;
+    bool fp16;
+};
+
+#endif // RIFE_CACHE_H
@@ -0,0 +1,22 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_EMBEDDED_H
+#define RIFE_EMBEDDED_H
+
+#include <cstddef>
+
+// One net of a model directory compiled into the module by tools/embed_models.py. The model.json
+// manifest of a directory, if any, is an entry named "model.json" with its text in param and no bin.
+struct rife_embedded_net
+{
+    const char* model;
+    const char* name;
+    const char* param;
+    const unsigned char* bin;
+    size_t bin_size;
+};
+
+// Returns the embedded net, e.g. ("rife-v4", "flownet"), or 0 when that model was not embedded.
+const rife_embedded_net* rife_find_embedded_net(const char* model, const char* name);
+
+#endif // RIFE_EMBEDDED_H
@@ -0,0 +1,601 @@
+// rife implemented with ncnn library
+
+#include "rife_model.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+bool RIFEModelInfo::supports_scale(float scale) const
+{
+    return std::any_of(scales.begin(), scales.end(), [scale](float s) { return fabsf(s - scale) < 1e-6f; });
+}
+
+int RIFEModelInfo::flow_channels() const
+{
+    return rife_v4 ? 0 : rife_v2 ? 4 : 2;
+}
+
+static bool has_input(const std::vector<std::string>& names, const std::string& name)
+{
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+static RIFEFlownetInput flownet_input(const std::string& blob, bool in0, bool in1, bool timestep, float scale)
+{
+    RIFEFlownetInput input;
+    input.blob = blob;
+    input.in0 = in0;
+    input.in1 = in1;
+    input.timestep = timestep;
+    input.scale = scale;
+    return input;
+}
+
+int rife_model_resolve_inputs(const std::vector<std::string>& names, bool uhd_mode, RIFEModelInfo& info, std::vector<RIFEFlownetInput>& inputs)
+{
+    inputs.clear();
+
+    // the original v4 graph takes the frames as in0/in1 next to the timestep plane in2, the lite
+    // variants pack the frames, and possibly the timestep plane, into their first input
+    if (info.flownet_inputs.empty())
+    {
+        if (has_input(names, info.flownet_in0) && has_input(names, info.flownet_in1))
+        {
+            info.flownet_inputs = "separate";
+        }
+        else if (!names.empty())
+        {
+            info.flownet_in0 = names[0];
+            info.flownet_inputs = info.timestep && has_input(names, info.flownet_timestep) ? "concat_images" : "concat_all";
+        }
+    }
+
+    if (info.flownet_inputs == "separate")
+    {
+        inputs.push_back(flownet_input(info.flownet_in0, true, false, false, 0.f));
+        inputs.push_back(flownet_input(info.flownet_in1, false, true, false, 0.f));
+    }
+    else
+    {
+        inputs.push_back(flownet_input(info.flownet_in0, true, true, info.timestep && info.flownet_inputs == "concat_all", 0.f));
+    }
+
+    if (info.timestep && info.flownet_inputs != "concat_all")
+        inputs.push_back(flownet_input(info.flownet_timestep, false, false, true, 0.f));
+
+    // a single input left over is the scale the flow is estimated at
+    std::vector<std::string> unused;
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        bool fed = names[i] == info.flownet_scale;
+        for (size_t j = 0; j < inputs.size(); j++)
+            fed = fed || names[i] == inputs[j].blob;
+
+        if (!fed)
+            unused.push_back(names[i]);
+    }
+
+    if (info.flownet_scale.empty() && unused.size() == 1 && unused[0] != info.flownet_timestep)
+    {
+        info.flownet_scale = unused[0];
+        unused.clear();
+    }
+
+    if (!info.flownet_scale.empty())
+        inputs.push_back(flownet_input(info.flownet_scale, false, false, false, uhd_mode ? 0.5f : 1.f));
+
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        if (!has_input(names, inputs[i].blob))
+        {
+            fprintf(stderr, "flownet has no input %s\n", inputs[i].blob.c_str());
+            return -1;
+        }
+    }
+
+    if (!unused.empty())
+    {
+        fprintf(stderr, "flownet input %s is not fed\n", unused[0].c_str());
+        return -1;
+    }
+
+    if (uhd_mode && info.flownet_scale.empty())
+    {
+        fprintf(stderr, "flownet has no scale input for uhd mode\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int rife_model_defaults(const std::string& family, RIFEModelInfo& info)
+{
+    info = RIFEModelInfo();
+
+    if (family == "rife")
+    {
+        info.rife_v2 = false;
+        info.rife_v4 = false;
+    }
+    else if (family == "rife-v2" || family == "rife-v3")
+    {
+        info.rife_v2 = true;
+        info.rife_v4 = false;
+    }
+    else if (family == "rife-v4")
+    {
+        info.rife_v2 = false;
+        info.rife_v4 = true;
+    }
+    else
+    {
+        fprintf(stderr, "unknown model family %s\n", family.c_str());
+        return -1;
+    }
+
+    info.padding = 32;
+    info.timestep = info.rife_v4;
+
+    if (info.rife_v4)
+    {
+        // the flownet of v4 blends the frames itself and runs at full resolution unless it has a scale input
+        info.scales = {1.f};
+
+        info.flownet_in0 = "in0";
+        info.flownet_in1 = "in1";
+        info.flownet_timestep = "in2";
+        info.flownet_out = "out0";
+        return 0;
+    }
+
+    info.scales = {1.f, 0.5f};
+
+    info.flownet_in0 = "input0";
+    info.flownet_in1 = "input1";
+    info.flownet_out = "flow";
+
+    info.contextnet_in = "input.1";
+    info.contextnet_flow0 = "flow.0";
+    info.contextnet_flow1 = info.rife_v2 ? "flow.0" : "flow.1";
+    for (int i = 0; i < 4; i++)
+    {
+        info.contextnet_out[i] = "f" + std::to_string(i + 1);
+    }
+
+    info.fusionnet_in0 = "img0";
+    info.fusionnet_in1 = "img1";
+    info.fusionnet_flow = "flow";
+    for (int i = 0; i < 4; i++)
+    {
+        info.fusionnet_ctx0[i] = std::to_string(i + 3);
+        info.fusionnet_ctx1[i] = std::to_string(i + 7);
+    }
+    info.fusionnet_out = "output";
+
+    return 0;
+}
+
+int rife_model_guess(const std::string& modeldir, RIFEModelInfo& info)
+{
+    // the more specific names first, every one of them contains "rife"
+    static const char* const families[] = {"rife-v2", "rife-v3", "rife-v4", "rife"};
+    for (size_t i = 0; i < sizeof(families) / sizeof(families[0]); i++)
+    {
+        if (modeldir.find(families[i]) != std::string::npos)
+            return rife_model_defaults(families[i], info);
+    }
+
+    fprintf(stderr, "unknown model dir type %s\n", modeldir.c_str());
+    return -1;
+}
+
+namespace {
+
+// just enough json for the manifest, numbers are kept as double
+struct JsonValue
+{
+    enum Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    Type type = Null;
+    bool b = false;
+    double n = 0;
+    std::string s;
+    std::vector<JsonValue> a;
+    std::vector<std::pair<std::string, JsonValue> > o;
+
+    const JsonValue* find(const char* key) const
+    {
+        for (size_t i = 0; i < o.size(); i++)
+        {
+            if (o[i].first == key)
+                return &o[i].second;
+        }
+
+        return 0;
+    }
+};
+
+class JsonParser
+{
+public:
+    explicit JsonParser(const char* _p)
+        : p(_p)
+    {
+    }
+
+    int parse(JsonValue& v)
+    {
+        if (parse_value(v) != 0)
+            return -1;
+
+        skip_space();
+        return *p == '\0' ? 0 : -1;
+    }
+
+private:
+    void skip_space()
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            p++;
+    }
+
+    bool consume(const char* token)
+    {
+        size_t len = strlen(token);
+        if (strncmp(p, token, len) != 0)
+            return false;
+
+        p += len;
+        return true;
+    }
+
+    int parse_value(JsonValue& v)
+    {
+        skip_space();
+
+        if (*p == '{')
+            return parse_object(v);
+
+        if (*p == '[')
+            return parse_array(v);
+
+        if (*p == '"')
+        {
+            v.type = JsonValue::String;
+            return parse_string(v.s);
+        }
+
+        if (consume("true"))
+        {
+            v.type = JsonValue::Bool;
+            v.b = true;
+            return 0;
+        }
+
+        if (consume("false"))
+        {
+            v.type = JsonValue::Bool;
+            v.b = false;
+            return 0;
+        }
+
+        if (consume("null"))
+        {
+            v.type = JsonValue::Null;
+            return 0;
+        }
+
+        char* end = 0;
+        v.n = strtod(p, &end);
+        if (end == p)
+            return -1;
+
+        v.type = JsonValue::Number;
+        p = end;
+        return 0;
+    }
+
+    int parse_string(std::string& s)
+    {
+        p++;
+
+        while (*p != '"')
+        {
+            if (*p == '\0')
+                return -1;
+
+            if (*p == '\\')
+            {
+                p++;
+                switch (*p)
+                {
+                case '"':
+                case '\\':
+                case '/':
+                    s += *p;
+                    break;
+                case 'n':
+                    s += '\n';
+                    break;
+                case 't':
+                    s += '\t';
+                    break;
+                default:
+                    // blob names never need anything else
+                    return -1;
+                }
+                p++;
+                continue;
+            }
+
+            s += *p++;
+        }
+
+        p++;
+        return 0;
+    }
+
+    int parse_array(JsonValue& v)
+    {
+        v.type = JsonValue::Array;
+        p++;
+
+        skip_space();
+        if (*p == ']')
+        {
+            p++;
+            return 0;
+        }
+
+        for (;;)
+        {
+            v.a.push_back(JsonValue());
+            if (parse_value(v.a.back()) != 0)
+                return -1;
+
+            skip_space();
+            if (*p == ']')
+            {
+                p++;
+                return 0;
+            }
+
+            if (*p++ != ',')
+                return -1;
+        }
+    }
+
+    int parse_object(JsonValue& v)
+    {
+        v.type = JsonValue::Object;
+        p++;
+
+        skip_space();
+        if (*p == '}')
+        {
+            p++;
+            return 0;
+        }
+
+        for (;;)
+        {
+            skip_space();
+            if (*p != '"')
+                return -1;
+
+            std::string key;
+            if (parse_string(key) != 0)
+                return -1;
+
+            skip_space();
+            if (*p++ != ':')
+                return -1;
+
+            v.o.push_back(std::make_pair(key, JsonValue()));
+            if (parse_value(v.o.back().second) != 0)
+                return -1;
+
+            skip_space();
+            if (*p == '}')
+            {
+                p++;
+                return 0;
+            }
+
+            if (*p++ != ',')
+                return -1;
+        }
+    }
+
+    const char* p;
+};
+
+} // namespace
+
+static int get_string(const JsonValue& obj, const char* key, std::string& value)
+{
+    const JsonValue* v = obj.find(key);
+    if (!v)
+        return 0;
+
+    if (v->type != JsonValue::String)
+    {
+        fprintf(stderr, "model.json: %s must be a string\n", key);
+        return -1;
+    }
+
+    value = v->s;
+    return 0;
+}
+
+static int get_strings(const JsonValue& obj, const char* key, std::string* values, int count)
+{
+    const JsonValue* v = obj.find(key);
+    if (!v)
+        return 0;
+
+    if (v->type != JsonValue::Array || (int)v->a.size() != count)
+    {
+        fprintf(stderr, "model.json: %s must be an array of %d strings\n", key, count);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (v->a[i].type != JsonValue::String)
+        {
+            fprintf(stderr, "model.json: %s must be an array of %d strings\n", key, count);
+            return -1;
+        }
+
+        values[i] = v->a[i].s;
+    }
+
+    return 0;
+}
+
+int rife_model_parse(const char* json, RIFEModelInfo& info)
+{
+    JsonValue root;
+    if (JsonParser(json).parse(root) != 0 || root.type != JsonValue::Object)
+    {
+        fprintf(stderr, "model.json: malformed json\n");
+        return -1;
+    }
+
+    std::string family;
+    if (get_string(root, "family", family) != 0)
+        return -1;
+
+    if (family.empty())
+    {
+        fprintf(stderr, "model.json: family is required\n");
+        return -1;
+    }
+
+    if (rife_model_defaults(family, info) != 0)
+        return -1;
+
+    if (const JsonValue* v = root.find("padding"))
+    {
+        if (v->type != JsonValue::Number || v->n < 1 || v->n != floor(v->n))
+        {
+            fprintf(stderr, "model.json: padding must be a positive integer\n");
+            return -1;
+        }
+
+        info.padding = (int)v->n;
+    }
+
+    if (const JsonValue* v = root.find("scales"))
+    {
+        if (v->type != JsonValue::Array || v->a.empty())
+        {
+            fprintf(stderr, "model.json: scales must be a non-empty array of numbers\n");
+            return -1;
+        }
+
+        info.scales.clear();
+        for (size_t i = 0; i < v->a.size(); i++)
+        {
+            if (v->a[i].type != JsonValue::Number || v->a[i].n <= 0)
+            {
+                fprintf(stderr, "model.json: scales must be a non-empty array of numbers\n");
+                return -1;
+            }
+
+            info.scales.push_back((float)v->a[i].n);
+        }
+    }
+
+    if (const JsonValue* v = root.find("timestep"))
+    {
+        if (v->type != JsonValue::Bool)
+        {
+            fprintf(stderr, "model.json: timestep must be a boolean\n");
+            return -1;
+        }
+
+        // only the v4 code path feeds a timestep into the graph
+        if (v->b && !info.rife_v4)
+        {
+            fprintf(stderr, "model.json: timestep requires the rife-v4 family\n");
+            return -1;
+        }
+
+        info.timestep = v->b;
+    }
+
+    if (get_string(root, "inputs", info.flownet_inputs) != 0)
+        return -1;
+
+    if (!info.flownet_inputs.empty())
+    {
+        if (!info.rife_v4)
+        {
+            fprintf(stderr, "model.json: inputs requires the rife-v4 family\n");
+            return -1;
+        }
+
+        if (info.flownet_inputs != "separate" && info.flownet_inputs != "concat_images" && info.flownet_inputs != "concat_all")
+        {
+            fprintf(stderr, "model.json: inputs must be separate, concat_images or concat_all\n");
+            return -1;
+        }
+    }
+
+    const JsonValue* blobs = root.find("blobs");
+    if (!blobs)
+        return 0;
+
+    if (blobs->type != JsonValue::Object)
+    {
+        fprintf(stderr, "model.json: blobs must be an object\n");
+        return -1;
+    }
+
+    if (const JsonValue* net = blobs->find("flownet"))
+    {
+        if (get_string(*net, "in0", info.flownet_in0) != 0
+                || get_string(*net, "in1", info.flownet_in1) != 0
+                || get_string(*net, "timestep", info.flownet_timestep) != 0
+                || get_string(*net, "scale", info.flownet_scale) != 0
+                || get_string(*net, "out", info.flownet_out) != 0)
+            return -1;
+    }
+
+    if (const JsonValue* net = blobs->find("contextnet"))
+    {
+        if (get_string(*net, "in", info.contextnet_in) != 0
+                || get_string(*net, "flow0", info.contextnet_flow0) != 0
+                || get_string(*net, "flow1", info.contextnet_flow1) != 0
+                || get_strings(*net, "out", info.contextnet_out, 4) != 0)
+            return -1;
+    }
+
+    if (const JsonValue* net = blobs->find("fusionnet"))
+    {
+        if (get_string(*net, "in0", info.fusionnet_in0) != 0
+                || get_string(*net, "in1", info.fusionnet_in1) != 0
+                || get_string(*net, "flow", info.fusionnet_flow) != 0
+                || get_strings(*net, "ctx0", info.fusionnet_ctx0, 4) != 0
+                || get_strings(*net, "ctx1", info.fusionnet_ctx1, 4) != 0
+                || get_string(*net, "out", info.fusionnet_out) != 0)
+            return -1;
+    }
+
+    return 0;
+}
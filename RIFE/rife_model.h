@@ -0,0 +1,81 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_MODEL_H
+#define RIFE_MODEL_H
+
+#include <string>
+#include <vector>
+
+// Describes how a model directory is run: the code path of its family, the granularity its inputs
+// are padded to, the flow scales it supports, whether it takes a timestep and the names of the
+// blobs it is fed and extracted through. Filled in from the family defaults, optionally overridden
+// by a model.json manifest next to the nets.
+struct RIFEModelInfo
+{
+    bool rife_v2;
+    bool rife_v4;
+    int padding;
+    std::vector<float> scales;
+    bool timestep;
+
+    // how a v4 flownet takes the frames: "separate" blobs in0 and in1, "concat_images" one 6 channel
+    // blob in0 next to the timestep blob, or "concat_all" one blob in0 holding the frames and the
+    // timestep plane; empty detects the arrangement from the graph inputs when the model is loaded
+    std::string flownet_inputs;
+
+    // flownet
+    std::string flownet_in0;
+    std::string flownet_in1;
+    std::string flownet_timestep;
+    std::string flownet_scale;
+    std::string flownet_out;
+
+    // contextnet
+    std::string contextnet_in;
+    std::string contextnet_flow0;
+    std::string contextnet_flow1;
+    std::string contextnet_out[4];
+
+    // fusionnet
+    std::string fusionnet_in0;
+    std::string fusionnet_in1;
+    std::string fusionnet_flow;
+    std::string fusionnet_ctx0[4];
+    std::string fusionnet_ctx1[4];
+    std::string fusionnet_out;
+
+    bool supports_scale(float scale) const;
+
+    // components of the flow flownet estimates, a vector per frame from rife-v2 on, 0 for rife-v4
+    // whose flow never leaves the graph
+    int flow_channels() const;
+};
+
+// One input a v4 flownet is fed: the padded frames and timestep plane concatenated into its blob, in
+// that order, or the scale the flow is estimated at when it takes none of them.
+struct RIFEFlownetInput
+{
+    std::string blob;
+    bool in0;
+    bool in1;
+    bool timestep;
+    float scale;
+};
+
+// Detects the arrangement and the scale input of a v4 flownet whose graph takes the inputs named,
+// when the model does not tell them, and lists the inputs it is fed, in uhd mode or not.
+int rife_model_resolve_inputs(const std::vector<std::string>& names, bool uhd_mode, RIFEModelInfo& info, std::vector<RIFEFlownetInput>& inputs);
+
+// Sets the defaults of a family, one of "rife", "rife-v2", "rife-v3" or "rife-v4".
+int rife_model_defaults(const std::string& family, RIFEModelInfo& info);
+
+// Sets the defaults of the family told by the name of a model directory, for models without a manifest.
+int rife_model_guess(const std::string& modeldir, RIFEModelInfo& info);
+
+// Parses a model.json manifest. Its "family" selects the defaults, every other key is optional
+// and overrides them, e.g.
+//   {"family": "rife-v4", "padding": 64, "scales": [1.0, 0.5], "timestep": true, "inputs": "separate",
+//    "blobs": {"flownet": {"in0": "in0", "in1": "in1", "timestep": "in2", "scale": "in3", "out": "out0"}}}
+int rife_model_parse(const char* json, RIFEModelInfo& info);
+
+#endif // RIFE_MODEL_H
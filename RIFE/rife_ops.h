@@ -9,6 +9,8 @@
 #include "layer.h"
 #include "pipeline.h"
 
+#include "rife_pipeline.h"
+
 class Warp : public ncnn::Layer
 {
 public:
@@ -19,9 +21,37 @@ public:
     virtual int forward(const std::vector<ncnn::VkMat>& bottom_blobs, std::vector<ncnn::VkMat>& top_blobs, ncnn::VkCompute& cmd, const ncnn::Option& opt) const;
 
 private:
-    ncnn::Pipeline* pipeline_warp;
-    ncnn::Pipeline* pipeline_warp_pack4;
-    ncnn::Pipeline* pipeline_warp_pack8;
+    // every instance sees one feature map size per resolution
+    SpecializedPipeline* pipeline_warp;
+    SpecializedPipeline* pipeline_warp_pack4;
+    SpecializedPipeline* pipeline_warp_pack8;
+};
+
+// Channel concatenation whose inputs may be warped on the fly, replacing rife.Warp layers that only
+// feed a Concat. Param 0 holds one flag per concatenated input, every flagged input takes an image
+// and a flow bottom blob and is warped straight into its place in the output.
+class WarpConcat : public ncnn::Layer
+{
+public:
+    WarpConcat();
+    virtual int load_param(const ncnn::ParamDict& pd);
+    virtual int create_pipeline(const ncnn::Option& opt);
+    virtual int destroy_pipeline(const ncnn::Option& opt);
+    virtual int forward(const std::vector<ncnn::Mat>& bottom_blobs, std::vector<ncnn::Mat>& top_blobs, const ncnn::Option& opt) const;
+    virtual int forward(const std::vector<ncnn::VkMat>& bottom_blobs, std::vector<ncnn::VkMat>& top_blobs, ncnn::VkCompute& cmd, const ncnn::Option& opt) const;
+
+private:
+    void record_slot(const ncnn::VkMat& image_blob, const ncnn::VkMat& flow_blob, bool warp, ncnn::VkMat& top_blob, int offset, ncnn::VkCompute& cmd) const;
+
+    std::vector<int> warped;
+
+    // every instance sees one shape per slot and resolution
+    SpecializedPipeline* pipeline_warp_concat;
+    SpecializedPipeline* pipeline_warp_concat_pack4;
+    SpecializedPipeline* pipeline_warp_concat_pack8;
+
+    // concatenates separately warped inputs when the output is fp16 packed without fp16 storage
+    ncnn::Layer* concat;
 };
 
 #endif // RIFE_OPS_H
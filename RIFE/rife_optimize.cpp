@@ -0,0 +1,235 @@
+// rife implemented with ncnn library
+
+#include "rife_optimize.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+struct GraphLayer
+{
+    std::string type;
+    std::string name;
+    std::vector<std::string> bottoms;
+    std::vector<std::string> tops;
+    std::vector<std::string> params;
+
+    bool removed;
+};
+
+class Graph
+{
+public:
+    int load(const char* param);
+    void save(std::string& param_out) const;
+
+    int fuse_warp_concat();
+
+    std::vector<std::string> outputs;
+
+private:
+    int get_int(const GraphLayer& layer, int id, int def) const;
+
+    bool is_output(const std::string& blob) const;
+    GraphLayer* producer(const std::string& blob);
+    std::vector<GraphLayer*> consumers(const std::string& blob);
+
+    std::vector<GraphLayer> layers;
+};
+
+int Graph::get_int(const GraphLayer& layer, int id, int def) const
+{
+    const std::string key = std::to_string(id) + "=";
+
+    for (size_t i = 0; i < layer.params.size(); i++)
+    {
+        if (layer.params[i].compare(0, key.size(), key) == 0)
+            return atoi(layer.params[i].c_str() + key.size());
+    }
+
+    return def;
+}
+
+int Graph::load(const char* param)
+{
+    std::istringstream is(param);
+
+    int magic = 0;
+    int layer_count = 0;
+    int blob_count = 0;
+    is >> magic >> layer_count >> blob_count;
+    if (magic != 7767517 || layer_count <= 0)
+        return -1;
+
+    std::string line;
+    std::getline(is, line);
+
+    while ((int)layers.size() < layer_count && std::getline(is, line))
+    {
+        std::istringstream ls(line);
+
+        GraphLayer layer;
+        int bottom_count = 0;
+        int top_count = 0;
+        if (!(ls >> layer.type >> layer.name >> bottom_count >> top_count))
+            continue;
+
+        layer.bottoms.resize(bottom_count);
+        for (int i = 0; i < bottom_count; i++)
+            ls >> layer.bottoms[i];
+
+        layer.tops.resize(top_count);
+        for (int i = 0; i < top_count; i++)
+            ls >> layer.tops[i];
+
+        std::string token;
+        while (ls >> token)
+            layer.params.push_back(token);
+
+        layer.removed = false;
+        layers.push_back(layer);
+    }
+
+    if ((int)layers.size() != layer_count)
+        return -1;
+
+    return 0;
+}
+
+void Graph::save(std::string& param_out) const
+{
+    std::vector<std::string> blobs;
+    int layer_count = 0;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        if (layers[i].removed)
+            continue;
+
+        layer_count++;
+        for (size_t j = 0; j < layers[i].tops.size(); j++)
+            blobs.push_back(layers[i].tops[j]);
+    }
+
+    std::ostringstream os;
+    os << 7767517 << "\n" << layer_count << " " << blobs.size() << "\n";
+
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        const GraphLayer& layer = layers[i];
+        if (layer.removed)
+            continue;
+
+        os << layer.type << " " << layer.name << " " << layer.bottoms.size() << " " << layer.tops.size();
+        for (size_t j = 0; j < layer.bottoms.size(); j++)
+            os << " " << layer.bottoms[j];
+        for (size_t j = 0; j < layer.tops.size(); j++)
+            os << " " << layer.tops[j];
+        for (size_t j = 0; j < layer.params.size(); j++)
+            os << " " << layer.params[j];
+        os << "\n";
+    }
+
+    param_out = os.str();
+}
+
+bool Graph::is_output(const std::string& blob) const
+{
+    return std::find(outputs.begin(), outputs.end(), blob) != outputs.end();
+}
+
+GraphLayer* Graph::producer(const std::string& blob)
+{
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        if (!layers[i].removed && std::find(layers[i].tops.begin(), layers[i].tops.end(), blob) != layers[i].tops.end())
+            return &layers[i];
+    }
+
+    return 0;
+}
+
+std::vector<GraphLayer*> Graph::consumers(const std::string& blob)
+{
+    std::vector<GraphLayer*> result;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        if (!layers[i].removed && std::find(layers[i].bottoms.begin(), layers[i].bottoms.end(), blob) != layers[i].bottoms.end())
+            result.push_back(&layers[i]);
+    }
+
+    return result;
+}
+
+int Graph::fuse_warp_concat()
+{
+    int removed = 0;
+
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        GraphLayer& concat = layers[i];
+        if (concat.removed || concat.type != "Concat" || concat.tops.size() != 1 || get_int(concat, 0, 0) != 0)
+            continue;
+
+        // warps whose output is only read by this concat are folded into it
+        std::vector<std::string> bottoms;
+        std::vector<GraphLayer*> warps;
+        std::ostringstream flags;
+        flags << "-23300=" << concat.bottoms.size();
+
+        for (size_t j = 0; j < concat.bottoms.size(); j++)
+        {
+            const std::string& blob = concat.bottoms[j];
+
+            GraphLayer* warp = producer(blob);
+            const bool fusable = warp && warp->type == "rife.Warp" && warp->bottoms.size() == 2 && !is_output(blob)
+                                 && consumers(blob).size() == 1
+                                 && std::count(concat.bottoms.begin(), concat.bottoms.end(), blob) == 1;
+
+            if (fusable)
+            {
+                bottoms.insert(bottoms.end(), warp->bottoms.begin(), warp->bottoms.end());
+                warps.push_back(warp);
+            }
+            else
+            {
+                bottoms.push_back(blob);
+            }
+
+            flags << "," << (fusable ? 1 : 0);
+        }
+
+        if (warps.empty())
+            continue;
+
+        for (size_t j = 0; j < warps.size(); j++)
+            warps[j]->removed = true;
+
+        concat.type = "rife.WarpConcat";
+        concat.bottoms = bottoms;
+        concat.params.assign(1, flags.str());
+
+        removed += (int)warps.size();
+    }
+
+    return removed;
+}
+
+} // namespace
+
+int rife_optimize_graph(const char* param, const std::vector<std::string>& outputs, std::string& param_out)
+{
+    Graph graph;
+    graph.outputs = outputs;
+
+    if (graph.load(param) != 0)
+        return -1;
+
+    const int removed = graph.fuse_warp_concat();
+    if (removed)
+        graph.save(param_out);
+
+    return removed;
+}
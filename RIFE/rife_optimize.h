@@ -0,0 +1,15 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_OPTIMIZE_H
+#define RIFE_OPTIMIZE_H
+
+#include <string>
+#include <vector>
+
+// Rewrites a graph before ncnn loads it. rife.Warp layers that only feed an axis 0 Concat are merged
+// into it as a rife.WarpConcat layer. Neither has weights, so the weights load as they are. Blobs
+// listed in outputs keep their values. Returns the number of layers removed, with the rewritten graph
+// in param_out when it is not 0, or -1 when the graph cannot be read.
+int rife_optimize_graph(const char* param, const std::vector<std::string>& outputs, std::string& param_out);
+
+#endif // RIFE_OPTIMIZE_H
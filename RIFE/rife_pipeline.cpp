@@ -0,0 +1,234 @@
+// rife implemented with ncnn library
+
+#include "rife_pipeline.h"
+
+#include <set>
+
+// shapes remembered, specialized or not, the least recently used one makes room for a new one
+static const size_t max_shapes = 8;
+
+// specialized pipelines per shader, a clip needs one, TTA two for the transposed frames
+static const int max_variants = 4;
+
+// ids of the uses begun so far and of the ones not ended yet
+static std::mutex uses_lock;
+static uint64_t uses_begun = 0;
+static std::set<uint64_t> active_uses;
+
+SpecializedPipeline::Use::Use()
+{
+    std::lock_guard<std::mutex> guard(uses_lock);
+    id = ++uses_begun;
+    active_uses.insert(id);
+}
+
+SpecializedPipeline::Use::~Use()
+{
+    std::lock_guard<std::mutex> guard(uses_lock);
+    active_uses.erase(id);
+}
+
+SpecializedPipeline::SpecializedPipeline(const ncnn::VulkanDevice* _vkdev, int _shape_count)
+{
+    vkdev = _vkdev;
+    shape_count = _shape_count;
+    local_size_w = 4;
+    local_size_h = 4;
+    local_size_c = 4;
+    generic = 0;
+    clock = 0;
+}
+
+SpecializedPipeline::~SpecializedPipeline()
+{
+    // the net owning the pipeline has finished its commands, and the gpu instance is still there
+    delete generic;
+
+    for (auto& variant : variants)
+        delete variant.second.pipeline;
+
+    for (size_t i = 0; i < retired.size(); i++)
+        delete retired[i].pipeline;
+}
+
+void SpecializedPipeline::set_optimal_local_size_xyz(int w, int h, int c)
+{
+    local_size_w = w;
+    local_size_h = h;
+    local_size_c = c;
+}
+
+int SpecializedPipeline::create(const uint32_t* spv_data, size_t spv_data_size, const std::vector<ncnn::vk_specialization_type>& _specializations)
+{
+    spirv.assign(spv_data, spv_data + spv_data_size / 4);
+    specializations = _specializations;
+
+    generic = create_variant(std::vector<int>(shape_count, 0));
+
+    return generic ? 0 : -1;
+}
+
+ncnn::Pipeline* SpecializedPipeline::create_variant(const std::vector<int>& shape) const
+{
+    std::vector<ncnn::vk_specialization_type> variant_specializations = specializations;
+    for (int i = 0; i < shape_count; i++)
+    {
+        ncnn::vk_specialization_type s;
+        s.i = shape[i];
+        variant_specializations.push_back(s);
+    }
+
+    ncnn::Pipeline* pipeline = new ncnn::Pipeline(vkdev);
+    pipeline->set_optimal_local_size_xyz(local_size_w, local_size_h, local_size_c);
+    if (pipeline->create(spirv.data(), spirv.size() * 4, variant_specializations) != 0)
+    {
+        delete pipeline;
+        return 0;
+    }
+
+    return pipeline;
+}
+
+void SpecializedPipeline::evict_least_recent(bool specialized_only) const
+{
+    auto victim = variants.end();
+    for (auto it = variants.begin(); it != variants.end(); ++it)
+    {
+        if (specialized_only && !it->second.pipeline)
+            continue;
+
+        if (victim == variants.end() || it->second.last_use < victim->second.last_use)
+            victim = it;
+    }
+
+    if (victim == variants.end())
+        return;
+
+    if (victim->second.pipeline)
+    {
+        Retired r;
+        r.pipeline = victim->second.pipeline;
+        {
+            std::lock_guard<std::mutex> guard(uses_lock);
+            r.last_use = uses_begun;
+        }
+        retired.push_back(r);
+    }
+
+    variants.erase(victim);
+}
+
+void SpecializedPipeline::collect_retired(std::vector<ncnn::Pipeline*>& destroyed) const
+{
+    if (retired.empty())
+        return;
+
+    // uses overlap all the time with several threads or clips, a pipeline waits only for the ones
+    // that could have recorded it
+    uint64_t oldest;
+    {
+        std::lock_guard<std::mutex> guard(uses_lock);
+        oldest = active_uses.empty() ? UINT64_MAX : *active_uses.begin();
+    }
+
+    for (size_t i = 0; i < retired.size();)
+    {
+        if (retired[i].last_use < oldest)
+        {
+            destroyed.push_back(retired[i].pipeline);
+            retired[i] = retired.back();
+            retired.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+const ncnn::Pipeline* SpecializedPipeline::get(const std::vector<ncnn::vk_constant_type>& constants) const
+{
+    std::vector<int> shape(shape_count);
+    for (int i = 0; i < shape_count; i++)
+    {
+        // a 0 in the shape would read the push constant anyway
+        shape[i] = constants[i].i;
+        if (shape[i] == 0)
+            return generic;
+    }
+
+    std::vector<ncnn::Pipeline*> destroyed;
+    const ncnn::Pipeline* pipeline = generic;
+    bool compile = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        collect_retired(destroyed);
+
+        auto it = variants.find(shape);
+        if (it == variants.end())
+        {
+            if (variants.size() >= max_shapes)
+                evict_least_recent(false);
+
+            variants.emplace(shape, Variant{1, false, false, 0, ++clock});
+        }
+        else
+        {
+            Variant& variant = it->second;
+            variant.last_use = ++clock;
+
+            if (variant.pipeline)
+            {
+                pipeline = variant.pipeline;
+            }
+            else if (!variant.failed && !variant.compiling && ++variant.uses >= 2)
+            {
+                // specialize on the second use, a shape being compiled counts against the limit
+                int specialized = 0;
+                for (const auto& v : variants)
+                {
+                    if (v.second.pipeline || v.second.compiling)
+                        specialized++;
+                }
+
+                if (specialized >= max_variants)
+                    evict_least_recent(true);
+
+                variant.compiling = true;
+                compile = true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < destroyed.size(); i++)
+        delete destroyed[i];
+
+    if (!compile)
+        return pipeline;
+
+    // compiling takes milliseconds, the other threads keep recording with the generic pipeline
+    // meanwhile instead of waiting on the lock
+    ncnn::Pipeline* specialized = create_variant(shape);
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = variants.find(shape);
+    if (it == variants.end())
+    {
+        // evicted while it was compiled, nothing recorded with it yet
+        delete specialized;
+        return generic;
+    }
+
+    Variant& variant = it->second;
+    variant.compiling = false;
+    if (!specialized)
+    {
+        // keep the shape on the generic pipeline without retrying
+        variant.failed = true;
+        return generic;
+    }
+
+    variant.pipeline = specialized;
+    return specialized;
+}
@@ -0,0 +1,91 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_PIPELINE_H
+#define RIFE_PIPELINE_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// ncnn
+#include "pipeline.h"
+
+// Compute pipeline of a custom shader whose leading integer push constants, the shape, are also
+// declared as specialization constants defaulting to 0 and read through psc(), like ncnn's own
+// shaders do. The generic pipeline reads the shape from the push constants. A shape that is
+// recorded again gets a pipeline with the shape baked in, so the compiler can strength-reduce
+// the indexing and drop bounds checks, while one-off shapes keep using the generic pipeline.
+// Shapes are kept least recently used first, so a clip changing resolution specializes its new
+// sizes and drops the ones it no longer uses.
+class SpecializedPipeline
+{
+public:
+    // Held while commands recorded with pipelines from get() may still run. A pipeline dropped from
+    // a cache is destroyed by a later get() once the uses that began before it was dropped have
+    // ended, later ones cannot get it, or with the cache, whichever comes first.
+    class Use
+    {
+    public:
+        Use();
+        ~Use();
+
+        Use(const Use&) = delete;
+        Use& operator=(const Use&) = delete;
+
+    private:
+        uint64_t id;
+    };
+
+    SpecializedPipeline(const ncnn::VulkanDevice* vkdev, int shape_count);
+    ~SpecializedPipeline();
+
+    SpecializedPipeline(const SpecializedPipeline&) = delete;
+    SpecializedPipeline& operator=(const SpecializedPipeline&) = delete;
+
+    void set_optimal_local_size_xyz(int w = 4, int h = 4, int c = 4);
+
+    // specializations holds the constants declared before the shape ones
+    int create(const uint32_t* spv_data, size_t spv_data_size, const std::vector<ncnn::vk_specialization_type>& specializations);
+
+    // the pipeline to record with these push constants, valid as long as a Use is held
+    const ncnn::Pipeline* get(const std::vector<ncnn::vk_constant_type>& constants) const;
+
+private:
+    ncnn::Pipeline* create_variant(const std::vector<int>& shape) const;
+    void evict_least_recent(bool specialized_only) const;
+    void collect_retired(std::vector<ncnn::Pipeline*>& destroyed) const;
+
+    const ncnn::VulkanDevice* vkdev;
+    int shape_count;
+    int local_size_w;
+    int local_size_h;
+    int local_size_c;
+    std::vector<uint32_t> spirv;
+    std::vector<ncnn::vk_specialization_type> specializations;
+    ncnn::Pipeline* generic;
+
+    struct Variant
+    {
+        int uses;
+        bool failed;
+        bool compiling;
+        ncnn::Pipeline* pipeline;
+        uint64_t last_use;
+    };
+
+    // a pipeline dropped while commands recorded with it may still be pending, with the id of the
+    // last use that had begun when it was dropped
+    struct Retired
+    {
+        ncnn::Pipeline* pipeline;
+        uint64_t last_use;
+    };
+
+    mutable std::mutex lock;
+    mutable uint64_t clock;
+    mutable std::map<std::vector<int>, Variant> variants;
+    mutable std::vector<Retired> retired;
+};
+
+#endif // RIFE_PIPELINE_H
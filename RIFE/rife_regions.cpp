@@ -0,0 +1,195 @@
+// rife implemented with ncnn library
+
+#include "rife_regions.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RIFE_REGIONS_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RIFE_REGIONS_NEON 1
+#endif
+
+static const int block_size = 64;
+
+// every region pays the fixed cost of a pass through the networks, past this many they are merged
+static const size_t max_regions = 4;
+
+// share of the frame above which the whole frame is interpolated in one pass
+static const float max_coverage = 0.75f;
+
+// whether any sample of [x0, x1) differs by more than threshold between the rows of the two frames
+static bool differs(const float* r0, const float* g0, const float* b0,
+                    const float* r1, const float* g1, const float* b1, int x0, int x1, float threshold)
+{
+    int x = x0;
+
+#if RIFE_REGIONS_SSE2
+    const __m128 t = _mm_set1_ps(threshold);
+    const __m128 sign = _mm_set1_ps(-0.f);
+    for (; x + 4 <= x1; x += 4)
+    {
+        __m128 dr = _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(r0 + x), _mm_loadu_ps(r1 + x)));
+        __m128 dg = _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(g0 + x), _mm_loadu_ps(g1 + x)));
+        __m128 db = _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(b0 + x), _mm_loadu_ps(b1 + x)));
+        if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_max_ps(_mm_max_ps(dr, dg), db), t)))
+            return true;
+    }
+#elif RIFE_REGIONS_NEON
+    const float32x4_t t = vdupq_n_f32(threshold);
+    for (; x + 4 <= x1; x += 4)
+    {
+        float32x4_t dr = vabdq_f32(vld1q_f32(r0 + x), vld1q_f32(r1 + x));
+        float32x4_t dg = vabdq_f32(vld1q_f32(g0 + x), vld1q_f32(g1 + x));
+        float32x4_t db = vabdq_f32(vld1q_f32(b0 + x), vld1q_f32(b1 + x));
+        if (vmaxvq_u32(vcgtq_f32(vmaxq_f32(vmaxq_f32(dr, dg), db), t)))
+            return true;
+    }
+#endif
+
+    for (; x < x1; x++)
+    {
+        if (std::abs(r0[x] - r1[x]) > threshold || std::abs(g0[x] - g1[x]) > threshold || std::abs(b0[x] - b1[x]) > threshold)
+            return true;
+    }
+
+    return false;
+}
+
+static bool overlaps(const RIFERect& a, const RIFERect& b)
+{
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+static bool merge_overlapping(std::vector<RIFERect>& regions)
+{
+    bool any = false;
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (size_t i = 0; i < regions.size() && !merged; i++)
+        {
+            for (size_t j = i + 1; j < regions.size() && !merged; j++)
+            {
+                if (overlaps(regions[i], regions[j]))
+                {
+                    regions[i] = rife_union_area(regions[i], regions[j]);
+                    regions.erase(regions.begin() + j);
+                    merged = true;
+                    any = true;
+                }
+            }
+        }
+    }
+
+    return any;
+}
+
+std::vector<RIFERect> rife_changed_regions(const float* r0, const float* g0, const float* b0,
+                                           const float* r1, const float* g1, const float* b1,
+                                           int w, int h, ptrdiff_t stride, float threshold, int halo, int granularity)
+{
+    const int bw = (w + block_size - 1) / block_size;
+    const int bh = (h + block_size - 1) / block_size;
+
+    // block mask, a block stops being compared once one of its rows differs
+    std::vector<unsigned char> changed(bw * bh, 0);
+    for (int y = 0; y < h; y++)
+    {
+        unsigned char* row = &changed[y / block_size * bw];
+        const ptrdiff_t offset = y * stride;
+        for (int bx = 0; bx < bw; bx++)
+        {
+            if (!row[bx] && differs(r0 + offset, g0 + offset, b0 + offset, r1 + offset, g1 + offset, b1 + offset,
+                                    bx * block_size, std::min(bx * block_size + block_size, w), threshold))
+                row[bx] = 1;
+        }
+    }
+
+    // blocks whose halos touch belong to one cluster
+    const int reach = 2 * halo / block_size + 1;
+
+    std::vector<RIFERect> regions;
+    std::vector<int> stack;
+    std::vector<unsigned char> visited(bw * bh, 0);
+    for (int i = 0; i < bw * bh; i++)
+    {
+        if (!changed[i] || visited[i])
+            continue;
+
+        int x0 = bw;
+        int y0 = bh;
+        int x1 = 0;
+        int y1 = 0;
+
+        visited[i] = 1;
+        stack.push_back(i);
+        while (!stack.empty())
+        {
+            const int bx = stack.back() % bw;
+            const int by = stack.back() / bw;
+            stack.pop_back();
+
+            x0 = std::min(x0, bx);
+            y0 = std::min(y0, by);
+            x1 = std::max(x1, bx + 1);
+            y1 = std::max(y1, by + 1);
+
+            for (int ny = std::max(by - reach, 0); ny <= std::min(by + reach, bh - 1); ny++)
+            {
+                for (int nx = std::max(bx - reach, 0); nx <= std::min(bx + reach, bw - 1); nx++)
+                {
+                    const int n = ny * bw + nx;
+                    if (changed[n] && !visited[n])
+                    {
+                        visited[n] = 1;
+                        stack.push_back(n);
+                    }
+                }
+            }
+        }
+
+        RIFERect region;
+        region.x = std::max(x0 * block_size - halo, 0);
+        region.y = std::max(y0 * block_size - halo, 0);
+        region.w = std::min(x1 * block_size + halo, w) - region.x;
+        region.h = std::min(y1 * block_size + halo, h) - region.y;
+        regions.push_back(region);
+    }
+
+    if (regions.empty())
+        return regions;
+
+    merge_overlapping(regions);
+
+    if (regions.size() > max_regions)
+    {
+        RIFERect all = {0, 0, 0, 0};
+        for (size_t i = 0; i < regions.size(); i++)
+            all = rife_union_area(all, regions[i]);
+        regions.assign(1, all);
+    }
+
+    // aligning grows regions, which may make them overlap again
+    do
+    {
+        for (size_t i = 0; i < regions.size(); i++)
+            regions[i] = rife_align_area(regions[i], w, h, granularity);
+    } while (merge_overlapping(regions));
+
+    size_t covered = 0;
+    for (size_t i = 0; i < regions.size(); i++)
+        covered += static_cast<size_t>(regions[i].w) * regions[i].h;
+
+    if (covered > max_coverage * w * h)
+    {
+        RIFERect whole = {0, 0, w, h};
+        regions.assign(1, whole);
+    }
+
+    return regions;
+}
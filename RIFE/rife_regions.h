@@ -0,0 +1,20 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_REGIONS_H
+#define RIFE_REGIONS_H
+
+#include <cstddef>
+#include <vector>
+
+#include "rife_borders.h"
+
+// Finds the parts of a pair of planar RGB frames that need interpolating. The frames are compared in
+// 64x64 blocks, a block changes when any sample differs by more than threshold. Changed blocks grow by
+// halo pixels, so motion reaching into static blocks stays in the picture the networks see, and every
+// cluster of them becomes one region aligned to granularity. Returns no region for identical frames,
+// and the whole frame when the regions would not save much.
+std::vector<RIFERect> rife_changed_regions(const float* r0, const float* g0, const float* b0,
+                                           const float* r1, const float* g1, const float* b1,
+                                           int w, int h, ptrdiff_t stride, float threshold, int halo, int granularity);
+
+#endif // RIFE_REGIONS_H
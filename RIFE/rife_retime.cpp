@@ -0,0 +1,85 @@
+// rife implemented with ncnn library
+
+#include "rife_retime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+int rife_read_timecodes(const std::filesystem::path& path, std::vector<double>& times)
+{
+    std::ifstream ifs(path);
+    if (!ifs)
+    {
+        fprintf(stderr, "open %s failed\n", reinterpret_cast<const char*>(path.u8string().c_str()));
+        return -1;
+    }
+
+    std::string line;
+    if (!std::getline(ifs, line) || line.rfind("# timecode format v2", 0) != 0)
+    {
+        fprintf(stderr, "%s is not in timecode format v2\n", reinterpret_cast<const char*>(path.u8string().c_str()));
+        return -1;
+    }
+
+    times.clear();
+    while (std::getline(ifs, line))
+    {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#')
+            continue;
+
+        char* end = 0;
+        double ms = strtod(line.c_str() + start, &end);
+        if (end == line.c_str() + start)
+        {
+            fprintf(stderr, "malformed timecode %s\n", line.c_str());
+            return -1;
+        }
+
+        if (!times.empty() && ms / 1000 < times.back())
+        {
+            fprintf(stderr, "timecode %s goes back in time\n", line.c_str());
+            return -1;
+        }
+
+        times.push_back(ms / 1000);
+    }
+
+    return 0;
+}
+
+std::vector<RIFERetimedFrame> rife_retime(const std::vector<double>& source_times, const std::vector<double>& target_times, double tolerance)
+{
+    std::vector<RIFERetimedFrame> frames(target_times.size());
+
+    const int last = static_cast<int>(source_times.size()) - 1;
+    for (size_t i = 0; i < target_times.size(); i++)
+    {
+        const double t = target_times[i];
+
+        // the source frame at or before t
+        int frame = static_cast<int>(std::upper_bound(source_times.begin(), source_times.end(), t) - source_times.begin()) - 1;
+        frame = std::clamp(frame, 0, last);
+
+        float timestep = 0.f;
+        if (frame < last && t > source_times[frame])
+        {
+            const double t0 = source_times[frame];
+            const double t1 = source_times[frame + 1];
+
+            if (t1 - t <= tolerance)
+                frame++;
+            else if (t - t0 > tolerance)
+                timestep = static_cast<float>((t - t0) / (t1 - t0));
+        }
+
+        frames[i].frame = frame;
+        frames[i].timestep = timestep;
+    }
+
+    return frames;
+}
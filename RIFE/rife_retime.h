@@ -0,0 +1,25 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_RETIME_H
+#define RIFE_RETIME_H
+
+#include <filesystem>
+#include <vector>
+
+// Where an output frame of a retimed clip comes from: source frame frame, interpolated towards the
+// next one at timestep, or copied when timestep is 0.
+struct RIFERetimedFrame
+{
+    int frame;
+    float timestep;
+};
+
+// Reads a timecode format v2 file, one presentation time in milliseconds per frame, into seconds.
+// A file may hold one time more than the clip has frames, the end of the last frame.
+int rife_read_timecodes(const std::filesystem::path& path, std::vector<double>& times);
+
+// Maps every target time onto the source timeline. Times within tolerance seconds of a source frame
+// copy it, times before the first or after the last source frame copy that frame.
+std::vector<RIFERetimedFrame> rife_retime(const std::vector<double>& source_times, const std::vector<double>& target_times, double tolerance);
+
+#endif // RIFE_RETIME_H
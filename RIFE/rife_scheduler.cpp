@@ -0,0 +1,124 @@
+// rife implemented with ncnn library
+
+#include "rife_scheduler.h"
+
+// jobs of one size a slot runs in a row while other streams wait with other sizes
+static const int max_run = 4;
+
+RIFEScheduler::RIFEScheduler(int _slots)
+{
+    slots.resize(_slots);
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        slots[i].busy = false;
+        slots[i].w = 0;
+        slots[i].h = 0;
+        slots[i].run = 0;
+    }
+
+    next_stream = 0;
+}
+
+int RIFEScheduler::add_stream()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    // the queue of a removed stream is empty and skipped until it is reused
+    if (!removed_streams.empty())
+    {
+        const int stream = removed_streams.back();
+        removed_streams.pop_back();
+        return stream;
+    }
+
+    queues.emplace_back();
+    return static_cast<int>(queues.size()) - 1;
+}
+
+void RIFEScheduler::remove_stream(int stream)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    removed_streams.push_back(stream);
+}
+
+int RIFEScheduler::acquire(int stream, int w, int h)
+{
+    Waiter waiter;
+    waiter.w = w;
+    waiter.h = h;
+    waiter.slot = -1;
+
+    std::unique_lock<std::mutex> guard(lock);
+    queues[stream].push_back(&waiter);
+    dispatch();
+
+    cond.wait(guard, [&] { return waiter.slot != -1; });
+    return waiter.slot;
+}
+
+void RIFEScheduler::release(int slot)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    slots[slot].busy = false;
+    dispatch();
+}
+
+void RIFEScheduler::dispatch()
+{
+    const int stream_count = static_cast<int>(queues.size());
+
+    bool granted = false;
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        Slot& slot = slots[i];
+        if (slot.busy)
+            continue;
+
+        // the first waiting stream in turn, or the first in turn with a frame of the size the slot ran
+        int pick = -1;
+        int same_size = -1;
+        for (int j = 0; j < stream_count; j++)
+        {
+            const int stream = (next_stream + j) % stream_count;
+            if (queues[stream].empty())
+                continue;
+
+            if (pick == -1)
+                pick = stream;
+
+            const Waiter* head = queues[stream].front();
+            if (slot.run < max_run && head->w == slot.w && head->h == slot.h)
+            {
+                same_size = stream;
+                break;
+            }
+        }
+
+        if (pick == -1)
+            break;
+
+        if (same_size != -1)
+        {
+            pick = same_size;
+            slot.run++;
+        }
+        else
+        {
+            slot.run = 1;
+        }
+
+        Waiter* waiter = queues[pick].front();
+        queues[pick].pop_front();
+
+        slot.busy = true;
+        slot.w = waiter->w;
+        slot.h = waiter->h;
+        waiter->slot = static_cast<int>(i);
+
+        next_stream = (pick + 1) % stream_count;
+        granted = true;
+    }
+
+    if (granted)
+        cond.notify_all();
+}
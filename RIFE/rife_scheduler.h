@@ -0,0 +1,60 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_SCHEDULER_H
+#define RIFE_SCHEDULER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Hands the concurrent slots of one loaded model to the streams sharing it. Streams take turns, so a
+// stream with many frames waiting cannot starve the others, and a slot that just ran a job prefers the
+// next stream waiting with a frame of the same size, which finds the allocator blocks and specialized
+// pipelines of that size still warm. It gives that preference to a few jobs in a row at most, then
+// falls back to the plain turn.
+class RIFEScheduler
+{
+public:
+    RIFEScheduler(int slots);
+
+    // Registers a stream, the returned id is passed to acquire.
+    int add_stream();
+
+    // Unregisters a stream with no job waiting, its id may be returned by a later add_stream.
+    void remove_stream(int stream);
+
+    // Blocks until the stream may run a job on a w x h frame, returns the slot to release after it.
+    int acquire(int stream, int w, int h);
+
+    void release(int slot);
+
+private:
+    struct Waiter
+    {
+        int w;
+        int h;
+        int slot;
+    };
+
+    struct Slot
+    {
+        bool busy;
+        int w;
+        int h;
+        int run;
+    };
+
+    // grants free slots to waiting streams, called with the lock held
+    void dispatch();
+
+private:
+    std::mutex lock;
+    std::condition_variable cond;
+    std::vector<std::deque<Waiter*> > queues;
+    std::vector<int> removed_streams;
+    std::vector<Slot> slots;
+    int next_stream;
+};
+
+#endif // RIFE_SCHEDULER_H
@@ -0,0 +1,761 @@
+// rife implemented with ncnn library
+
+#include "rife_server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include "rife_cache.h"
+
+// bumped whenever a message changes, clients and servers of different versions refuse each other
+static const int32_t protocol_version = 2;
+static const char protocol_magic[8] = {'R', 'I', 'F', 'E', 'S', 'R', 'V', '1'};
+
+// most outputs one job interpolates, far more than any factor asks for
+static const int32_t max_count = 1024;
+
+// largest width and height of a job, the size of its segment cannot overflow below them
+static const int32_t max_dimension = 1 << 15;
+
+// sent once per connection, the model dir and the manifest follow. client is 0 on the first connection
+// of a client and the id the server answered it with on the others.
+struct HelloMessage
+{
+    char magic[8];
+    int32_t version;
+    int32_t embedded;
+    int32_t tta_mode;
+    int32_t uhd_mode;
+    int32_t optimize;
+    int32_t w;
+    int32_t h;
+    uint32_t modeldir_size;
+    uint32_t manifest_size;
+    int64_t client;
+};
+
+// answers the hello with the id of the client, the reason of a failure follows
+struct HelloReply
+{
+    int32_t status;
+    uint32_t message_size;
+    int64_t client;
+};
+
+// one process_multi call on a stream of the client, count timesteps follow. The segment holds the planes of src0, src1 and every
+// output packed w x h one after another, a new segment comes attached to the message as a descriptor.
+struct JobMessage
+{
+    int64_t stream;
+    int32_t w;
+    int32_t h;
+    int32_t count;
+    int32_t new_segment;
+    uint64_t segment_size;
+};
+
+#ifdef MSG_NOSIGNAL
+static const int send_flags = MSG_NOSIGNAL;
+#else
+static const int send_flags = 0;
+#endif
+
+static int send_all(int fd, const void* data, size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        ssize_t n = send(fd, p, size, send_flags);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+static int recv_all(int fd, void* data, size_t size)
+{
+    char* p = static_cast<char*>(data);
+    while (size > 0)
+    {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+// the descriptor travels with the first bytes of the message
+static int send_with_fd(int fd, const void* data, size_t size, int passfd)
+{
+    iovec iov;
+    iov.iov_base = const_cast<void*>(data);
+    iov.iov_len = size;
+
+    union
+    {
+        cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &passfd, sizeof(int));
+
+    ssize_t n;
+    do
+    {
+        n = sendmsg(fd, &msg, send_flags);
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0)
+        return -1;
+
+    return send_all(fd, static_cast<const char*>(data) + n, size - n);
+}
+
+// passfd is -1 unless a descriptor came with the message
+static int recv_with_fd(int fd, void* data, size_t size, int* passfd)
+{
+    *passfd = -1;
+
+    iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = size;
+
+    union
+    {
+        cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t n;
+    do
+    {
+        n = recvmsg(fd, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0)
+        return -1;
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(passfd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    if (recv_all(fd, static_cast<char*>(data) + n, size - n) != 0)
+    {
+        if (*passfd != -1)
+            ::close(*passfd);
+        *passfd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int connect_socket(const std::string& socketpath)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketpath.size() >= sizeof(addr.sun_path))
+        return -1;
+    memcpy(addr.sun_path, socketpath.c_str(), socketpath.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// whether the process at the other end runs as the user of this one
+static bool peer_is_owner(int fd)
+{
+#ifdef SO_PEERCRED
+    ucred cred;
+    socklen_t size = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &size) != 0)
+        return false;
+
+    return cred.uid == geteuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(fd, &uid, &gid) != 0)
+        return false;
+
+    return uid == geteuid();
+#endif
+}
+
+// an anonymous shared memory segment, the name is gone before anyone else could open it
+static int create_segment(size_t size)
+{
+    static std::atomic<unsigned int> counter(0);
+
+    char name[64];
+    snprintf(name, sizeof(name), "/rife-%d-%u", static_cast<int>(getpid()), counter++);
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1)
+        return -1;
+
+    shm_unlink(name);
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+size_t rife_server_segment_size(int w, int h, int count)
+{
+    if (w < 1 || h < 1 || w > max_dimension || h > max_dimension || count < 1 || count > max_count)
+        return 0;
+
+    return static_cast<size_t>(w) * h * 3 * (2 + count) * sizeof(float);
+}
+
+RIFEClient::RIFEClient(const std::string& _socketpath, const RIFEServerModel& _model)
+{
+    socketpath = _socketpath;
+    model = _model;
+    id = 0;
+    next_stream = 0;
+}
+
+RIFEClient::~RIFEClient()
+{
+    for (size_t i = 0; i < idle.size(); i++)
+    {
+        close(idle[i]);
+    }
+}
+
+int RIFEClient::open(std::string& error)
+{
+    Connection* connection = connect(error);
+    if (!connection)
+        return -1;
+
+    std::lock_guard<std::mutex> guard(lock);
+    idle.push_back(connection);
+    return 0;
+}
+
+int64_t RIFEClient::add_stream()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return next_stream++;
+}
+
+RIFEClient::Connection* RIFEClient::connect(std::string& error) const
+{
+    int fd = connect_socket(socketpath);
+    if (fd == -1)
+    {
+        error = "failed to connect to " + socketpath;
+        return 0;
+    }
+
+    HelloMessage hello;
+    memset(&hello, 0, sizeof(hello));
+    memcpy(hello.magic, protocol_magic, sizeof(protocol_magic));
+    hello.version = protocol_version;
+    hello.embedded = model.embedded;
+    hello.tta_mode = model.tta_mode;
+    hello.uhd_mode = model.uhd_mode;
+    hello.optimize = model.optimize;
+    hello.w = model.w;
+    hello.h = model.h;
+    hello.modeldir_size = static_cast<uint32_t>(model.modeldir.size());
+    hello.manifest_size = static_cast<uint32_t>(model.manifest.size());
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        hello.client = id;
+    }
+
+    // the server loads the model before it answers, the first connection waits for that
+    HelloReply reply;
+    if (send_all(fd, &hello, sizeof(hello)) != 0 || send_all(fd, model.modeldir.data(), model.modeldir.size()) != 0
+            || send_all(fd, model.manifest.data(), model.manifest.size()) != 0 || recv_all(fd, &reply, sizeof(reply)) != 0)
+    {
+        error = "lost the connection to " + socketpath;
+        ::close(fd);
+        return 0;
+    }
+
+    if (reply.status != 0)
+    {
+        error.resize(reply.message_size);
+        if (recv_all(fd, &error[0], error.size()) != 0 || error.empty())
+            error = "the server refused the model";
+        ::close(fd);
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        id = reply.client;
+    }
+
+    Connection* connection = new Connection;
+    connection->fd = fd;
+    connection->segment = 0;
+    connection->segment_size = 0;
+    return connection;
+}
+
+void RIFEClient::close(Connection* connection) const
+{
+    if (connection->segment)
+        munmap(connection->segment, connection->segment_size);
+    ::close(connection->fd);
+    delete connection;
+}
+
+int RIFEClient::process_multi(int64_t stream, const float* src0R, const float* src0G, const float* src0B,
+                              const float* src1R, const float* src1G, const float* src1B,
+                              float* const* dstR, float* const* dstG, float* const* dstB, const float* timesteps, const int count,
+                              const int w, const int h, const ptrdiff_t stride) const
+{
+    Connection* connection = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!idle.empty())
+        {
+            connection = idle.back();
+            idle.pop_back();
+        }
+    }
+
+    if (!connection)
+    {
+        std::string error;
+        connection = connect(error);
+        if (!connection)
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return -1;
+        }
+    }
+
+    const size_t plane_size = static_cast<size_t>(w) * h;
+    const size_t segment_size = rife_server_segment_size(w, h, count);
+    if (segment_size == 0)
+    {
+        fprintf(stderr, "a job of %d outputs at %dx%d is too large for the server\n", count, w, h);
+        std::lock_guard<std::mutex> guard(lock);
+        idle.push_back(connection);
+        return -1;
+    }
+
+    // segments only grow, a connection keeps the largest job it ran
+    int segment_fd = -1;
+    if (segment_size > connection->segment_size)
+    {
+        if (connection->segment)
+            munmap(connection->segment, connection->segment_size);
+        connection->segment = 0;
+        connection->segment_size = 0;
+
+        segment_fd = create_segment(segment_size);
+        void* segment = segment_fd == -1 ? MAP_FAILED : mmap(0, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+        if (segment == MAP_FAILED)
+        {
+            fprintf(stderr, "failed to create a shared memory segment of %zu bytes\n", segment_size);
+            if (segment_fd != -1)
+                ::close(segment_fd);
+            close(connection);
+            return -1;
+        }
+
+        connection->segment = static_cast<float*>(segment);
+        connection->segment_size = segment_size;
+    }
+
+    const float* srcs[6] = {src0R, src0G, src0B, src1R, src1G, src1B};
+    for (int c = 0; c < 6; c++)
+    {
+        float* plane = connection->segment + plane_size * c;
+        for (int y = 0; y < h; y++)
+        {
+            memcpy(plane + static_cast<size_t>(y) * w, srcs[c] + y * stride, w * sizeof(float));
+        }
+    }
+
+    std::vector<char> message(sizeof(JobMessage) + count * sizeof(float));
+    JobMessage job;
+    job.stream = stream;
+    job.w = w;
+    job.h = h;
+    job.count = count;
+    job.new_segment = segment_fd != -1;
+    job.segment_size = connection->segment_size;
+    memcpy(message.data(), &job, sizeof(job));
+    memcpy(message.data() + sizeof(job), timesteps, count * sizeof(float));
+
+    int ret = segment_fd != -1 ? send_with_fd(connection->fd, message.data(), message.size(), segment_fd)
+                               : send_all(connection->fd, message.data(), message.size());
+
+    // the server has its own reference to the segment once it was sent
+    if (segment_fd != -1)
+        ::close(segment_fd);
+
+    int32_t status = -1;
+    if (ret != 0 || recv_all(connection->fd, &status, sizeof(status)) != 0)
+    {
+        fprintf(stderr, "lost the connection to %s\n", socketpath.c_str());
+        close(connection);
+        return -1;
+    }
+
+    if (status == 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            float* dsts[3] = {dstR[i], dstG[i], dstB[i]};
+            for (int c = 0; c < 3; c++)
+            {
+                const float* plane = connection->segment + plane_size * (6 + i * 3 + c);
+                for (int y = 0; y < h; y++)
+                {
+                    memcpy(dsts[c] + y * stride, plane + static_cast<size_t>(y) * w, w * sizeof(float));
+                }
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        idle.push_back(connection);
+    }
+
+    return status == 0 ? 0 : -1;
+}
+
+RIFEServer::RIFEServer(int slots, const RIFEServerLoader& _loader) : scheduler(slots)
+{
+    loader = _loader;
+    next_client = 0;
+}
+
+int RIFEServer::run(const std::string& socketpath)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketpath.size() >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "socket path %s is too long\n", socketpath.c_str());
+        return -1;
+    }
+    memcpy(addr.sun_path, socketpath.c_str(), socketpath.size());
+
+    // a socket file nobody accepts on is left over from a server that did not exit cleanly
+    int other = connect_socket(socketpath);
+    if (other != -1)
+    {
+        ::close(other);
+        fprintf(stderr, "another server is listening on %s\n", socketpath.c_str());
+        return -1;
+    }
+    unlink(socketpath.c_str());
+
+    // clients have the server load any model dir they name, only the user running it may connect, the
+    // socket is created without access for others instead of being restricted after it can be reached
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    const mode_t mask = umask(0177);
+    const int bound = fd == -1 ? -1 : bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+    umask(mask);
+
+    if (fd == -1 || bound != 0 || listen(fd, 64) != 0)
+    {
+        fprintf(stderr, "listen on %s failed, %s\n", socketpath.c_str(), strerror(errno));
+        if (fd != -1)
+            ::close(fd);
+        return -1;
+    }
+
+    for (;;)
+    {
+        int client = accept(fd, 0, 0);
+        if (client == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            fprintf(stderr, "accept failed, %s\n", strerror(errno));
+            ::close(fd);
+            return -1;
+        }
+
+        // the socket mode already keeps others out, unless the directory it is in was shared
+        if (!peer_is_owner(client))
+        {
+            fprintf(stderr, "refused a client of another user\n");
+            ::close(client);
+            continue;
+        }
+
+        std::thread(&RIFEServer::serve, this, client).detach();
+    }
+}
+
+void RIFEServer::serve(int fd)
+{
+    HelloMessage hello;
+    RIFEServerModel model;
+    if (recv_all(fd, &hello, sizeof(hello)) != 0 || memcmp(hello.magic, protocol_magic, sizeof(protocol_magic)) != 0
+            || hello.modeldir_size > 4096 || hello.manifest_size > 1 << 20)
+    {
+        ::close(fd);
+        return;
+    }
+
+    model.modeldir.resize(hello.modeldir_size);
+    model.manifest.resize(hello.manifest_size);
+    if ((!model.modeldir.empty() && recv_all(fd, &model.modeldir[0], model.modeldir.size()) != 0)
+            || (!model.manifest.empty() && recv_all(fd, &model.manifest[0], model.manifest.size()) != 0))
+    {
+        ::close(fd);
+        return;
+    }
+
+    model.embedded = hello.embedded != 0;
+    model.tta_mode = hello.tta_mode != 0;
+    model.uhd_mode = hello.uhd_mode != 0;
+    model.optimize = hello.optimize != 0;
+    model.w = hello.w;
+    model.h = hello.h;
+
+    std::shared_ptr<RIFEServerEngine> engine;
+    std::string error;
+    if (hello.version != protocol_version)
+        error = "the server speaks protocol version " + std::to_string(protocol_version);
+    else if (!(engine = load(model)))
+        error = "the server failed to load " + model.modeldir;
+
+    HelloReply reply;
+    reply.status = engine ? 0 : -1;
+    reply.message_size = static_cast<uint32_t>(error.size());
+    reply.client = engine ? join(hello.client) : 0;
+    if (send_all(fd, &reply, sizeof(reply)) != 0 || send_all(fd, error.data(), error.size()) != 0 || !engine)
+    {
+        if (engine)
+            leave(reply.client);
+        ::close(fd);
+        return;
+    }
+
+    float* segment = 0;
+    size_t segment_size = 0;
+    std::vector<float> timesteps;
+    std::vector<float*> dstR;
+    std::vector<float*> dstG;
+    std::vector<float*> dstB;
+
+    for (;;)
+    {
+        JobMessage job;
+        int segment_fd;
+        if (recv_with_fd(fd, &job, sizeof(job), &segment_fd) != 0)
+            break;
+
+        if (job.new_segment)
+        {
+            if (segment)
+                munmap(segment, segment_size);
+            segment = 0;
+            segment_size = 0;
+
+            // the size the client claims is checked against the object, touching pages past its end would
+            // raise SIGBUS and take every client down with the server
+            struct stat st;
+            void* mapping = MAP_FAILED;
+            if (segment_fd != -1 && fstat(segment_fd, &st) == 0 && job.segment_size > 0 && static_cast<uint64_t>(st.st_size) == job.segment_size)
+                mapping = mmap(0, job.segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+            if (segment_fd != -1)
+                ::close(segment_fd);
+            if (mapping == MAP_FAILED)
+                break;
+
+            segment = static_cast<float*>(mapping);
+            segment_size = job.segment_size;
+        }
+        else if (segment_fd != -1)
+        {
+            ::close(segment_fd);
+        }
+
+        if (job.count < 1 || job.count > max_count)
+            break;
+
+        timesteps.resize(job.count);
+        if (recv_all(fd, timesteps.data(), job.count * sizeof(float)) != 0)
+            break;
+
+        int32_t status = -1;
+        const size_t plane_size = static_cast<size_t>(job.w) * job.h;
+        const size_t job_size = rife_server_segment_size(job.w, job.h, job.count);
+        if (job_size > 0 && segment && job_size <= segment_size)
+        {
+            dstR.resize(job.count);
+            dstG.resize(job.count);
+            dstB.resize(job.count);
+            for (int i = 0; i < job.count; i++)
+            {
+                dstR[i] = segment + plane_size * (6 + i * 3);
+                dstG[i] = segment + plane_size * (6 + i * 3 + 1);
+                dstB[i] = segment + plane_size * (6 + i * 3 + 2);
+            }
+
+            int slot = scheduler.acquire(stream(reply.client, job.stream), job.w, job.h);
+            status = engine->process_multi(segment, segment + plane_size, segment + plane_size * 2,
+                                           segment + plane_size * 3, segment + plane_size * 4, segment + plane_size * 5,
+                                           dstR.data(), dstG.data(), dstB.data(), timesteps.data(), job.count, job.w, job.h, job.w);
+            scheduler.release(slot);
+        }
+
+        if (send_all(fd, &status, sizeof(status)) != 0)
+            break;
+    }
+
+    if (segment)
+        munmap(segment, segment_size);
+    ::close(fd);
+
+    leave(reply.client);
+}
+
+std::shared_ptr<RIFEServerEngine> RIFEServer::load(const RIFEServerModel& model)
+{
+    // the manifest decides how the nets are run, the same dir described differently is another model
+    char manifest_hash[17];
+    snprintf(manifest_hash, sizeof(manifest_hash), "%016llx",
+             static_cast<unsigned long long>(rife_hash(model.manifest.data(), model.manifest.size(), 0)));
+
+    const std::string key = model.modeldir + "|manifest=" + manifest_hash + "|embedded=" + std::to_string(model.embedded)
+                            + "|tta=" + std::to_string(model.tta_mode) + "|uhd=" + std::to_string(model.uhd_mode)
+                            + "|optimize=" + std::to_string(model.optimize);
+
+    std::shared_ptr<LoadedModel> loaded;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::shared_ptr<LoadedModel>& entry = models[key];
+        if (!entry)
+            entry = std::make_shared<LoadedModel>();
+        loaded = entry;
+    }
+
+    // clients asking for a model that is being loaded wait for it, a failed load is retried by the next
+    std::lock_guard<std::mutex> guard(loaded->lock);
+    if (loaded->engine)
+        return loaded->engine;
+
+    std::shared_ptr<RIFEServerEngine> engine = loader(model);
+    if (!engine)
+        return 0;
+
+    fprintf(stderr, "loaded %s\n", key.c_str());
+    loaded->engine = engine;
+    return engine;
+}
+
+int64_t RIFEServer::join(int64_t client)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    // an id the server never handed out gets a new one, so it cannot collide with a later client
+    if (client <= 0 || client > next_client)
+        client = ++next_client;
+
+    std::map<int64_t, Client>::iterator it = clients.find(client);
+    if (it == clients.end())
+    {
+        it = clients.insert(std::make_pair(client, Client())).first;
+        it->second.connections = 0;
+    }
+
+    it->second.connections++;
+    return client;
+}
+
+void RIFEServer::leave(int64_t client)
+{
+    // the streams of a client go with its last connection, none of them has a job waiting then
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<int64_t, Client>::iterator it = clients.find(client);
+    if (it == clients.end() || --it->second.connections > 0)
+        return;
+
+    for (std::map<int64_t, int>::iterator s = it->second.streams.begin(); s != it->second.streams.end(); ++s)
+    {
+        scheduler.remove_stream(s->second);
+    }
+
+    clients.erase(it);
+}
+
+int RIFEServer::stream(int64_t client, int64_t client_stream)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<int64_t, int>& streams = clients[client].streams;
+    std::map<int64_t, int>::iterator it = streams.find(client_stream);
+    if (it != streams.end())
+        return it->second;
+
+    int id = scheduler.add_stream();
+    streams[client_stream] = id;
+    return id;
+}
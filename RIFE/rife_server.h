@@ -0,0 +1,139 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_SERVER_H
+#define RIFE_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rife_scheduler.h"
+
+// A model as a client asks the server for it, models with the same settings are loaded once and
+// shared by all clients.
+struct RIFEServerModel
+{
+    // directory of the nets, or the name of a model compiled into the server
+    std::string modeldir;
+    bool embedded;
+
+    // model.json as the client read it, empty to tell the family by the directory name
+    std::string manifest;
+
+    bool tta_mode;
+    bool uhd_mode;
+    bool optimize;
+
+    // resolution the tuning file is looked up for when the model is loaded, 0 for none
+    int w;
+    int h;
+};
+
+// Bytes of the shared memory segment a job of count outputs at w x h needs, 0 if the server refuses
+// jobs of that size.
+size_t rife_server_segment_size(int w, int h, int count);
+
+// Runs process_multi of a model loaded by a server process. Every concurrent call takes a connection of
+// its own, which exchanges the frames through a shared memory segment, only the timesteps and the status
+// go over the socket.
+class RIFEClient
+{
+public:
+    RIFEClient(const std::string& socketpath, const RIFEServerModel& model);
+    ~RIFEClient();
+
+    // Connects and waits until the server has the model loaded, error has the reason on failure.
+    int open(std::string& error);
+
+    // Registers a stream with the scheduler of the server, the streams of all clients take turns on its gpu.
+    // The server tells the streams of clients apart, the ids only need to differ within one.
+    int64_t add_stream();
+
+    // Returns -1 if the server failed the job or cannot be reached.
+    int process_multi(int64_t stream, const float* src0R, const float* src0G, const float* src0B,
+                      const float* src1R, const float* src1G, const float* src1B,
+                      float* const* dstR, float* const* dstG, float* const* dstB, const float* timesteps, const int count,
+                      const int w, const int h, const ptrdiff_t stride) const;
+
+private:
+    struct Connection
+    {
+        int fd;
+        float* segment;
+        size_t segment_size;
+    };
+
+    Connection* connect(std::string& error) const;
+    void close(Connection* connection) const;
+
+private:
+    std::string socketpath;
+    RIFEServerModel model;
+    mutable std::mutex lock;
+    mutable std::vector<Connection*> idle;
+    // assigned by the server on the first connection and sent with every later one, 0 until then
+    mutable int64_t id;
+    int64_t next_stream;
+};
+
+// A model the server has loaded. rife-server runs a RIFE behind it, the tests an interpolation that
+// needs no gpu.
+class RIFEServerEngine
+{
+public:
+    virtual ~RIFEServerEngine() {}
+
+    virtual int process_multi(const float* src0R, const float* src0G, const float* src0B,
+                              const float* src1R, const float* src1G, const float* src1B,
+                              float* const* dstR, float* const* dstG, float* const* dstB, const float* timesteps, const int count,
+                              const int w, const int h, const ptrdiff_t stride) const = 0;
+};
+
+// Loads a model a client asked for, returns null on failure.
+typedef std::function<std::shared_ptr<RIFEServerEngine>(const RIFEServerModel& model)> RIFEServerLoader;
+
+// Keeps models loaded for the clients connecting to a unix domain socket and runs their jobs on one gpu,
+// at most slots at a time, handed out by a single scheduler.
+class RIFEServer
+{
+public:
+    RIFEServer(int slots, const RIFEServerLoader& loader);
+
+    // Serves clients until the process is ended, returns -1 if the socket cannot be listened on.
+    int run(const std::string& socketpath);
+
+private:
+    struct LoadedModel
+    {
+        std::mutex lock;
+        std::shared_ptr<RIFEServerEngine> engine;
+    };
+
+    // the streams a client registered, kept while it has a connection open
+    struct Client
+    {
+        int connections;
+        std::map<int64_t, int> streams;
+    };
+
+    void serve(int fd);
+    std::shared_ptr<RIFEServerEngine> load(const RIFEServerModel& model);
+    int64_t join(int64_t client);
+    void leave(int64_t client);
+    int stream(int64_t client, int64_t client_stream);
+
+private:
+    RIFEServerLoader loader;
+    RIFEScheduler scheduler;
+    std::mutex lock;
+    std::map<std::string, std::shared_ptr<LoadedModel> > models;
+    std::map<int64_t, Client> clients;
+    int64_t next_client;
+};
+
+#endif // RIFE_SERVER_H
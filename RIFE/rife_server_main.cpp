@@ -0,0 +1,146 @@
+// rife implemented with ncnn library
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// ncnn
+#include "gpu.h"
+
+#include "rife.h"
+#include "rife_server.h"
+#include "rife_tuning.h"
+
+class RIFEEngine : public RIFEServerEngine
+{
+public:
+    RIFEEngine(int gpuid, const RIFEModelInfo& info, const RIFEServerModel& model)
+        : rife(gpuid, info, model.tta_mode, model.uhd_mode, 1, model.optimize)
+    {
+    }
+
+    virtual int process_multi(const float* src0R, const float* src0G, const float* src0B,
+                              const float* src1R, const float* src1G, const float* src1B,
+                              float* const* dstR, float* const* dstG, float* const* dstB, const float* timesteps, const int count,
+                              const int w, const int h, const ptrdiff_t stride) const
+    {
+        return rife.process_multi(src0R, src0G, src0B, src1R, src1G, src1B, dstR, dstG, dstB, timesteps, count, w, h, stride);
+    }
+
+    RIFE rife;
+};
+
+static std::shared_ptr<RIFEServerEngine> load_model(int gpuid, const std::filesystem::path& tuningdir, const RIFEServerModel& model)
+{
+    RIFEModelInfo info;
+    if (model.manifest.empty() ? rife_model_guess(model.modeldir, info) : rife_model_parse(model.manifest.c_str(), info))
+        return 0;
+
+    // the tuning is the one for the resolution of the client that loads the model first
+    RIFETuning tuning;
+    if (!tuningdir.empty() && model.w > 0 && model.h > 0)
+    {
+        rife_tuning_load(rife_tuning_path(tuningdir, ncnn::get_gpu_info(gpuid)),
+                         rife_tuning_key(model.modeldir, model.w, model.h, model.tta_mode, model.uhd_mode, model.optimize), tuning);
+    }
+
+    std::shared_ptr<RIFEEngine> engine = std::make_shared<RIFEEngine>(gpuid, info, model);
+    engine->rife.set_tuning(tuning);
+
+    int ret;
+    if (model.embedded)
+    {
+#ifdef RIFE_EMBEDDED_MODELS
+        ret = engine->rife.load_embedded(model.modeldir);
+#else
+        fprintf(stderr, "%s is not compiled into the server\n", model.modeldir.c_str());
+        ret = -1;
+#endif
+    }
+    else
+    {
+        ret = engine->rife.load(model.modeldir);
+    }
+
+    if (ret != 0)
+        return 0;
+
+    return engine;
+}
+
+static void print_usage()
+{
+    fprintf(stderr, "Usage: rife-server [options] socket\n");
+    fprintf(stderr, "  -g gpu-id        gpu device to use (default=auto)\n");
+    fprintf(stderr, "  -j gpu-thread    jobs run at the same time for all clients (default=2)\n");
+    fprintf(stderr, "  -t tuning-dir    directory of the tuning files the plugin writes (default=the user's cache directory)\n");
+}
+
+int main(int argc, char** argv)
+{
+    int gpuid = -1;
+    int gpu_thread = 2;
+    std::filesystem::path tuningdir = rife_tuning_default_dir();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "g:j:t:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'g':
+            gpuid = atoi(optarg);
+            break;
+        case 'j':
+            gpu_thread = atoi(optarg);
+            break;
+        case 't':
+            tuningdir = optarg;
+            break;
+        case 'h':
+        default:
+            print_usage();
+            return -1;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        print_usage();
+        return -1;
+    }
+
+    // a client going away mid job must not end the server
+    signal(SIGPIPE, SIG_IGN);
+
+    ncnn::create_gpu_instance();
+
+    if (gpuid == -1)
+        gpuid = ncnn::get_default_gpu_index();
+
+    if (gpuid < 0 || gpuid >= ncnn::get_gpu_count())
+    {
+        fprintf(stderr, "invalid gpu device\n");
+        ncnn::destroy_gpu_instance();
+        return -1;
+    }
+
+    const int queue_count = static_cast<int>(ncnn::get_gpu_info(gpuid).compute_queue_count());
+    if (gpu_thread < 1 || gpu_thread > queue_count)
+    {
+        fprintf(stderr, "gpu-thread must be between 1 and %d\n", queue_count);
+        ncnn::destroy_gpu_instance();
+        return -1;
+    }
+
+    fprintf(stderr, "[%d %s] serving on %s\n", gpuid, ncnn::get_gpu_info(gpuid).device_name(), argv[optind]);
+
+    int ret;
+    {
+        RIFEServer server(gpu_thread, [&](const RIFEServerModel& model) { return load_model(gpuid, tuningdir, model); });
+        ret = server.run(argv[optind]);
+    }
+
+    ncnn::destroy_gpu_instance();
+    return ret;
+}
@@ -0,0 +1,35 @@
+// rife implemented with ncnn library
+
+#include "rife_spirv.h"
+
+#include <cstring>
+
+// ncnn
+#include "gpu.h"
+
+#ifdef RIFE_AOT_SPIRV
+#include "rife_spirv.spv.h"
+#endif
+
+int rife_compile_spirv(const char* name, const char* comp_data, int comp_data_size, const ncnn::Option& opt, std::vector<uint32_t>& spirv)
+{
+#ifdef RIFE_AOT_SPIRV
+    if (!opt.use_fp16_arithmetic && !opt.use_int8_storage)
+    {
+        const char* variant = opt.use_fp16_storage ? "fp16s" : opt.use_fp16_packed ? "fp16p" : "fp32";
+
+        for (const auto& entry : rife_spirv_table)
+        {
+            if (strcmp(entry.name, name) == 0 && strcmp(entry.variant, variant) == 0)
+            {
+                spirv.assign(entry.data, entry.data + entry.size / sizeof(uint32_t));
+                return 0;
+            }
+        }
+    }
+#else
+    (void)name;
+#endif
+
+    return ncnn::compile_spirv_module(comp_data, comp_data_size, opt, spirv);
+}
@@ -0,0 +1,16 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_SPIRV_H
+#define RIFE_SPIRV_H
+
+#include <cstdint>
+#include <vector>
+
+// ncnn
+#include "option.h"
+
+// Fetches the SPIR-V of one of the custom shaders. Binaries compiled at build time are used when
+// one matches the storage options, otherwise the embedded GLSL is compiled at runtime.
+int rife_compile_spirv(const char* name, const char* comp_data, int comp_data_size, const ncnn::Option& opt, std::vector<uint32_t>& spirv);
+
+#endif // RIFE_SPIRV_H
@@ -0,0 +1,105 @@
+// rife implemented with ncnn library
+
+#include "rife_tasks.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+struct Task
+{
+    RIFETaskGroup* group;
+    std::function<void()> func;
+};
+
+struct Workers
+{
+    std::mutex lock;
+    std::condition_variable done;
+    std::deque<Task> queue;
+    int count = 0;
+};
+
+Workers& workers()
+{
+    // never destroyed, a worker may still be leaving while the process exits
+    static Workers* instance = new Workers;
+    return *instance;
+}
+} // namespace
+
+RIFETaskGroup::RIFETaskGroup()
+{
+    pending = 0;
+}
+
+RIFETaskGroup::~RIFETaskGroup()
+{
+    wait();
+}
+
+void RIFETaskGroup::run(const std::function<void()>& task)
+{
+    Workers& w = workers();
+    std::lock_guard<std::mutex> guard(w.lock);
+
+    w.queue.push_back({this, task});
+    pending++;
+
+    const int max_count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (w.count < max_count && w.count < static_cast<int>(w.queue.size()))
+    {
+        std::thread(work).detach();
+        w.count++;
+    }
+}
+
+void RIFETaskGroup::wait()
+{
+    Workers& w = workers();
+    std::unique_lock<std::mutex> guard(w.lock);
+
+    while (pending > 0)
+    {
+        auto it = std::find_if(w.queue.begin(), w.queue.end(), [this](const Task& task) { return task.group == this; });
+        if (it == w.queue.end())
+        {
+            w.done.wait(guard);
+            continue;
+        }
+
+        Task task = std::move(*it);
+        w.queue.erase(it);
+
+        guard.unlock();
+        task.func();
+        guard.lock();
+
+        pending--;
+    }
+}
+
+void RIFETaskGroup::work()
+{
+    Workers& w = workers();
+    std::unique_lock<std::mutex> guard(w.lock);
+
+    while (!w.queue.empty())
+    {
+        Task task = std::move(w.queue.front());
+        w.queue.pop_front();
+
+        guard.unlock();
+        task.func();
+        guard.lock();
+
+        if (--task.group->pending == 0)
+            w.done.notify_all();
+    }
+
+    w.count--;
+}
@@ -0,0 +1,32 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_TASKS_H
+#define RIFE_TASKS_H
+
+#include <functional>
+
+// Runs the steps of loading a model that do not depend on each other, the net loads and the shader
+// compiles, on workers shared by every model of the process. There are never more workers than cpu
+// cores however many models load at once, and they exit when no steps are left. wait runs the steps of
+// its own group that no worker took yet, so a group never waits on steps of another one and a step may
+// wait on a group of its own, like a layer compiling its variants while its net loads.
+class RIFETaskGroup
+{
+public:
+    RIFETaskGroup();
+    ~RIFETaskGroup();
+
+    void run(const std::function<void()>& task);
+
+    // Returns once every step passed to run has finished.
+    void wait();
+
+private:
+    static void work();
+
+private:
+    // steps queued or running, guarded by the lock of the workers
+    int pending;
+};
+
+#endif // RIFE_TASKS_H
@@ -0,0 +1,245 @@
+// rife implemented with ncnn library
+
+#include "rife_tuning.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+RIFETuning::RIFETuning()
+{
+    local_size_w = 8;
+    local_size_h = 8;
+
+    ncnn::Option opt;
+    use_winograd_convolution = opt.use_winograd_convolution;
+    use_sgemm_convolution = opt.use_sgemm_convolution;
+    use_shader_pack8 = opt.use_shader_pack8;
+    use_cooperative_matrix = opt.use_cooperative_matrix;
+}
+
+void RIFETuning::apply(ncnn::Option& opt) const
+{
+    opt.use_winograd_convolution = use_winograd_convolution;
+    opt.use_sgemm_convolution = use_sgemm_convolution;
+    opt.use_shader_pack8 = use_shader_pack8;
+    opt.use_cooperative_matrix = use_cooperative_matrix;
+}
+
+std::filesystem::path rife_tuning_default_dir()
+{
+#if _WIN32
+    const wchar_t* local_app_data = _wgetenv(L"LOCALAPPDATA");
+    if (local_app_data && local_app_data[0])
+        return std::filesystem::path(local_app_data) / "vs-rife";
+#else
+    const char* cache_home = getenv("XDG_CACHE_HOME");
+    if (cache_home && cache_home[0])
+        return std::filesystem::path(cache_home) / "vs-rife";
+
+    const char* home = getenv("HOME");
+    if (home && home[0])
+        return std::filesystem::path(home) / ".cache" / "vs-rife";
+#endif
+
+    return std::filesystem::path();
+}
+
+std::filesystem::path rife_tuning_path(const std::filesystem::path& dir, const ncnn::GpuInfo& info)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "tuning-%04x-%04x-%08x.txt", info.vendor_id(), info.device_id(), info.driver_version());
+    return dir / name;
+}
+
+std::string rife_tuning_key(const std::string& model, int w, int h, bool tta_mode, bool uhd_mode, bool optimize)
+{
+    return model + " " + std::to_string(w) + "x" + std::to_string(h)
+           + " tta=" + std::to_string(tta_mode) + " uhd=" + std::to_string(uhd_mode) + " optimize=" + std::to_string(optimize);
+}
+
+// a line is "<key>: local_size=8x8 winograd=1 sgemm=1 pack8=1 cooperative_matrix=1", the key is
+// everything up to the last colon since model paths may contain colons themselves
+static bool split_line(const std::string& line, std::string& key, std::string& value)
+{
+    if (line.empty() || line[0] == '#')
+        return false;
+
+    size_t colon = line.rfind(": ");
+    if (colon == std::string::npos)
+        return false;
+
+    key = line.substr(0, colon);
+    value = line.substr(colon + 2);
+    return true;
+}
+
+static std::string format_value(const RIFETuning& tuning)
+{
+    char value[128];
+    snprintf(value, sizeof(value), "local_size=%dx%d winograd=%d sgemm=%d pack8=%d cooperative_matrix=%d",
+             tuning.local_size_w, tuning.local_size_h, tuning.use_winograd_convolution, tuning.use_sgemm_convolution,
+             tuning.use_shader_pack8, tuning.use_cooperative_matrix);
+    return value;
+}
+
+static int parse_value(const std::string& value, RIFETuning& tuning)
+{
+    int local_size_w = 0;
+    int local_size_h = 0;
+    int winograd = 0;
+    int sgemm = 0;
+    int pack8 = 0;
+    int cooperative_matrix = 0;
+    int nscan = sscanf(value.c_str(), "local_size=%dx%d winograd=%d sgemm=%d pack8=%d cooperative_matrix=%d",
+                       &local_size_w, &local_size_h, &winograd, &sgemm, &pack8, &cooperative_matrix);
+    if (nscan != 6 || local_size_w < 1 || local_size_h < 1)
+        return -1;
+
+    tuning.local_size_w = local_size_w;
+    tuning.local_size_h = local_size_h;
+    tuning.use_winograd_convolution = winograd != 0;
+    tuning.use_sgemm_convolution = sgemm != 0;
+    tuning.use_shader_pack8 = pack8 != 0;
+    tuning.use_cooperative_matrix = cooperative_matrix != 0;
+    return 0;
+}
+
+int rife_tuning_load(const std::filesystem::path& path, const std::string& key, RIFETuning& tuning)
+{
+    std::ifstream ifs(path);
+    if (!ifs)
+        return -1;
+
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        std::string line_key;
+        std::string value;
+        if (!split_line(line, line_key, value) || line_key != key)
+            continue;
+
+        if (parse_value(value, tuning) != 0)
+        {
+            fprintf(stderr, "malformed tuning for %s in %s\n", key.c_str(), reinterpret_cast<const char*>(path.u8string().c_str()));
+            return -1;
+        }
+
+        return 0;
+    }
+
+    return -1;
+}
+
+int rife_tuning_save(const std::filesystem::path& path, const std::string& key, const RIFETuning& tuning)
+{
+    std::vector<std::string> lines;
+    {
+        std::ifstream ifs(path);
+        std::string line;
+        while (std::getline(ifs, line))
+        {
+            std::string line_key;
+            std::string value;
+            if (split_line(line, line_key, value) && line_key == key)
+                continue;
+
+            lines.push_back(line);
+        }
+    }
+
+    if (lines.empty())
+        lines.push_back("# rife autotuning, one line per model, resolution and mode");
+
+    lines.push_back(key + ": " + format_value(tuning));
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // write next to the file and rename over it, so a concurrent reader never sees half of it
+    std::filesystem::path tmppath = path;
+    tmppath += ".tmp";
+    {
+        std::ofstream ofs(tmppath, std::ios::trunc);
+        for (size_t i = 0; i < lines.size(); i++)
+        {
+            ofs << lines[i] << '\n';
+        }
+
+        if (!ofs.flush())
+        {
+            fprintf(stderr, "write %s failed\n", reinterpret_cast<const char*>(tmppath.u8string().c_str()));
+            return -1;
+        }
+    }
+
+    std::filesystem::rename(tmppath, path, ec);
+    if (ec)
+    {
+        fprintf(stderr, "write %s failed\n", reinterpret_cast<const char*>(path.u8string().c_str()));
+        std::filesystem::remove(tmppath, ec);
+        return -1;
+    }
+
+    return 0;
+}
+
+int rife_autotune(const ncnn::GpuInfo& info, const std::function<double(const RIFETuning&)>& benchmark, RIFETuning& tuning)
+{
+    RIFETuning best;
+    double best_time = benchmark(best);
+    if (best_time < 0)
+        return -1;
+
+    auto try_candidate = [&](const RIFETuning& candidate) {
+        double time = benchmark(candidate);
+        if (time >= 0 && time < best_time)
+        {
+            best = candidate;
+            best_time = time;
+        }
+    };
+
+    // ncnn clamps the local size to what the device allows
+    static const int local_sizes[][2] = {{16, 8}, {16, 16}, {32, 4}, {32, 8}};
+    const RIFETuning base = best;
+    for (int i = 0; i < 4; i++)
+    {
+        RIFETuning candidate = base;
+        candidate.local_size_w = local_sizes[i][0];
+        candidate.local_size_h = local_sizes[i][1];
+        try_candidate(candidate);
+    }
+
+    {
+        RIFETuning candidate = best;
+        candidate.use_winograd_convolution = !candidate.use_winograd_convolution;
+        try_candidate(candidate);
+    }
+
+    {
+        RIFETuning candidate = best;
+        candidate.use_sgemm_convolution = !candidate.use_sgemm_convolution;
+        try_candidate(candidate);
+    }
+
+    {
+        RIFETuning candidate = best;
+        candidate.use_shader_pack8 = !candidate.use_shader_pack8;
+        try_candidate(candidate);
+    }
+
+    // without support ncnn ignores the option anyway
+    if (info.support_cooperative_matrix())
+    {
+        RIFETuning candidate = best;
+        candidate.use_cooperative_matrix = !candidate.use_cooperative_matrix;
+        try_candidate(candidate);
+    }
+
+    tuning = best;
+    return 0;
+}
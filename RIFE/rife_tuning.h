@@ -0,0 +1,54 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_TUNING_H
+#define RIFE_TUNING_H
+
+#include <filesystem>
+#include <functional>
+#include <string>
+
+// ncnn
+#include "gpu.h"
+#include "option.h"
+
+// Settings that only change how fast a model runs, not what it outputs. The autotuner picks them per
+// device, model and resolution, and they are kept in one tuning file per device and driver.
+struct RIFETuning
+{
+    // local size of the custom shaders in x and y
+    int local_size_w;
+    int local_size_h;
+
+    // how ncnn runs the convolutions
+    bool use_winograd_convolution;
+    bool use_sgemm_convolution;
+    bool use_shader_pack8;
+    bool use_cooperative_matrix;
+
+    // the local size the custom shaders were written for and the choices ncnn makes by default
+    RIFETuning();
+
+    void apply(ncnn::Option& opt) const;
+};
+
+// Directory the tuning files go to by default, the user's cache directory, or empty when there is none.
+std::filesystem::path rife_tuning_default_dir();
+
+// Tuning file of a device, a driver update starts over with a new file.
+std::filesystem::path rife_tuning_path(const std::filesystem::path& dir, const ncnn::GpuInfo& info);
+
+// Line of the tuning file a configuration is stored under.
+std::string rife_tuning_key(const std::string& model, int w, int h, bool tta_mode, bool uhd_mode, bool optimize);
+
+// Returns -1 when the file has no settings for the key, leaving tuning untouched.
+int rife_tuning_load(const std::filesystem::path& path, const std::string& key, RIFETuning& tuning);
+
+// Adds or replaces the settings of the key, other lines of the file are kept.
+int rife_tuning_save(const std::filesystem::path& path, const std::string& key, const RIFETuning& tuning);
+
+// Picks the fastest settings starting from the defaults, one setting at a time: the local size first,
+// then each convolution choice flipped, keeping whichever was fastest so far. benchmark returns the
+// seconds an interpolation takes with the given settings, or a negative value when they fail.
+int rife_autotune(const ncnn::GpuInfo& info, const std::function<double(const RIFETuning&)>& benchmark, RIFETuning& tuning);
+
+#endif // RIFE_TUNING_H
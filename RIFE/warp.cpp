@@ -1,6 +1,8 @@
 // rife implemented with ncnn library
 
 #include "rife_ops.h"
+#include "rife_spirv.h"
+#include "rife_tasks.h"
 
 #include "warp.comp.hex.h"
 #include "warp_pack4.comp.hex.h"
@@ -24,58 +26,65 @@ int Warp::create_pipeline(const Option& opt)
 
     std::vector<vk_specialization_type> specializations(0 + 0);
 
+    // compile the pack1/pack4/pack8 variants concurrently
+    RIFETaskGroup jobs;
+
     // pack1
-    {
+    jobs.run([&] {
         static std::vector<uint32_t> spirv;
         static ncnn::Mutex lock;
         {
             ncnn::MutexLockGuard guard(lock);
             if (spirv.empty())
             {
-                compile_spirv_module(warp_comp_data, sizeof(warp_comp_data), opt, spirv);
+                rife_compile_spirv("warp", warp_comp_data, sizeof(warp_comp_data), opt, spirv);
             }
         }
 
-        pipeline_warp = new Pipeline(vkdev);
+        pipeline_warp = new SpecializedPipeline(vkdev, 4);
         pipeline_warp->set_optimal_local_size_xyz();
         pipeline_warp->create(spirv.data(), spirv.size() * 4, specializations);
-    }
+    });
 
     // pack4
-    {
+    jobs.run([&] {
         static std::vector<uint32_t> spirv;
         static ncnn::Mutex lock;
         {
             ncnn::MutexLockGuard guard(lock);
             if (spirv.empty())
             {
-                compile_spirv_module(warp_pack4_comp_data, sizeof(warp_pack4_comp_data), opt, spirv);
+                rife_compile_spirv("warp_pack4", warp_pack4_comp_data, sizeof(warp_pack4_comp_data), opt, spirv);
             }
         }
 
-        pipeline_warp_pack4 = new Pipeline(vkdev);
+        pipeline_warp_pack4 = new SpecializedPipeline(vkdev, 4);
         pipeline_warp_pack4->set_optimal_local_size_xyz();
         pipeline_warp_pack4->create(spirv.data(), spirv.size() * 4, specializations);
-    }
+    });
 
     // pack8
     if (opt.use_shader_pack8)
     {
-        static std::vector<uint32_t> spirv;
-        static ncnn::Mutex lock;
-        {
-            ncnn::MutexLockGuard guard(lock);
-            if (spirv.empty())
+        jobs.run([&] {
+            static std::vector<uint32_t> spirv;
+            static ncnn::Mutex lock;
             {
-                compile_spirv_module(warp_pack8_comp_data, sizeof(warp_pack8_comp_data), opt, spirv);
+                ncnn::MutexLockGuard guard(lock);
+                if (spirv.empty())
+                {
+                    rife_compile_spirv("warp_pack8", warp_pack8_comp_data, sizeof(warp_pack8_comp_data), opt, spirv);
+                }
             }
-        }
 
-        pipeline_warp_pack8 = new Pipeline(vkdev);
-        pipeline_warp_pack8->set_optimal_local_size_xyz();
-        pipeline_warp_pack8->create(spirv.data(), spirv.size() * 4, specializations);
+            pipeline_warp_pack8 = new SpecializedPipeline(vkdev, 4);
+            pipeline_warp_pack8->set_optimal_local_size_xyz();
+            pipeline_warp_pack8->create(spirv.data(), spirv.size() * 4, specializations);
+        });
     }
 
+    jobs.wait();
+
     return 0;
 }
 
@@ -196,15 +205,15 @@ int Warp::forward(const std::vector<VkMat>& bottom_blobs, std::vector<VkMat>& to
 
     if (elempack == 8)
     {
-        cmd.record_pipeline(pipeline_warp_pack8, bindings, constants, top_blob);
+        cmd.record_pipeline(pipeline_warp_pack8->get(constants), bindings, constants, top_blob);
     }
     else if (elempack == 4)
     {
-        cmd.record_pipeline(pipeline_warp_pack4, bindings, constants, top_blob);
+        cmd.record_pipeline(pipeline_warp_pack4->get(constants), bindings, constants, top_blob);
     }
     else // if (elempack == 1)
     {
-        cmd.record_pipeline(pipeline_warp, bindings, constants, top_blob);
+        cmd.record_pipeline(pipeline_warp->get(constants), bindings, constants, top_blob);
     }
 
     return 0;
@@ -0,0 +1,346 @@
+// rife implemented with ncnn library
+
+#include "rife_ops.h"
+#include "rife_spirv.h"
+#include "rife_tasks.h"
+
+#include <string.h>
+
+#include "warp_concat.comp.hex.h"
+#include "warp_concat_pack4.comp.hex.h"
+#include "warp_concat_pack8.comp.hex.h"
+
+using namespace ncnn;
+
+WarpConcat::WarpConcat()
+{
+    one_blob_only = false;
+    support_vulkan = true;
+
+    pipeline_warp_concat = 0;
+    pipeline_warp_concat_pack4 = 0;
+    pipeline_warp_concat_pack8 = 0;
+    concat = 0;
+}
+
+int WarpConcat::load_param(const ParamDict& pd)
+{
+    Mat flags = pd.get(0, Mat());
+    if (flags.empty())
+        return -1;
+
+    const int* ptr = flags;
+    warped.assign(ptr, ptr + flags.w);
+
+    return 0;
+}
+
+int WarpConcat::create_pipeline(const Option& opt)
+{
+    if (!vkdev)
+        return 0;
+
+    std::vector<vk_specialization_type> specializations(0 + 0);
+
+    // compile the pack1/pack4/pack8 variants concurrently
+    RIFETaskGroup jobs;
+
+    // pack1
+    jobs.run([&] {
+        static std::vector<uint32_t> spirv;
+        static ncnn::Mutex lock;
+        {
+            ncnn::MutexLockGuard guard(lock);
+            if (spirv.empty())
+            {
+                rife_compile_spirv("warp_concat", warp_concat_comp_data, sizeof(warp_concat_comp_data), opt, spirv);
+            }
+        }
+
+        pipeline_warp_concat = new SpecializedPipeline(vkdev, 9);
+        pipeline_warp_concat->set_optimal_local_size_xyz();
+        pipeline_warp_concat->create(spirv.data(), spirv.size() * 4, specializations);
+    });
+
+    // pack4
+    jobs.run([&] {
+        static std::vector<uint32_t> spirv;
+        static ncnn::Mutex lock;
+        {
+            ncnn::MutexLockGuard guard(lock);
+            if (spirv.empty())
+            {
+                rife_compile_spirv("warp_concat_pack4", warp_concat_pack4_comp_data, sizeof(warp_concat_pack4_comp_data), opt, spirv);
+            }
+        }
+
+        pipeline_warp_concat_pack4 = new SpecializedPipeline(vkdev, 9);
+        pipeline_warp_concat_pack4->set_optimal_local_size_xyz();
+        pipeline_warp_concat_pack4->create(spirv.data(), spirv.size() * 4, specializations);
+    });
+
+    // pack8
+    if (opt.use_shader_pack8)
+    {
+        jobs.run([&] {
+            static std::vector<uint32_t> spirv;
+            static ncnn::Mutex lock;
+            {
+                ncnn::MutexLockGuard guard(lock);
+                if (spirv.empty())
+                {
+                    rife_compile_spirv("warp_concat_pack8", warp_concat_pack8_comp_data, sizeof(warp_concat_pack8_comp_data), opt, spirv);
+                }
+            }
+
+            pipeline_warp_concat_pack8 = new SpecializedPipeline(vkdev, 9);
+            pipeline_warp_concat_pack8->set_optimal_local_size_xyz();
+            pipeline_warp_concat_pack8->create(spirv.data(), spirv.size() * 4, specializations);
+        });
+    }
+
+    jobs.wait();
+
+    {
+        concat = ncnn::create_layer("Concat");
+        concat->vkdev = vkdev;
+
+        ncnn::ParamDict pd;
+        pd.set(0, 0);// axis
+        concat->load_param(pd);
+
+        concat->create_pipeline(opt);
+    }
+
+    return 0;
+}
+
+int WarpConcat::destroy_pipeline(const Option& opt)
+{
+    delete pipeline_warp_concat;
+    pipeline_warp_concat = 0;
+
+    delete pipeline_warp_concat_pack4;
+    pipeline_warp_concat_pack4 = 0;
+
+    delete pipeline_warp_concat_pack8;
+    pipeline_warp_concat_pack8 = 0;
+
+    if (concat)
+    {
+        concat->destroy_pipeline(opt);
+        delete concat;
+        concat = 0;
+    }
+
+    return 0;
+}
+
+static void warp_channel(const Mat& image, const Mat& flow_blob, float* outptr)
+{
+    const int w = image.w;
+    const int h = image.h;
+
+    const float* fxptr = flow_blob.channel(0);
+    const float* fyptr = flow_blob.channel(1);
+
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            float sample_x = x + fxptr[0];
+            float sample_y = y + fyptr[0];
+
+            // bilinear interpolate
+            int x0 = floor(sample_x);
+            int y0 = floor(sample_y);
+            int x1 = x0 + 1;
+            int y1 = y0 + 1;
+
+            x0 = std::min(std::max(x0, 0), w - 1);
+            y0 = std::min(std::max(y0, 0), h - 1);
+            x1 = std::min(std::max(x1, 0), w - 1);
+            y1 = std::min(std::max(y1, 0), h - 1);
+
+            float alpha = sample_x - x0;
+            float beta = sample_y - y0;
+
+            float v0 = image.row(y0)[x0];
+            float v1 = image.row(y0)[x1];
+            float v2 = image.row(y1)[x0];
+            float v3 = image.row(y1)[x1];
+
+            float v4 = v0 * (1 - alpha) + v1 * alpha;
+            float v5 = v2 * (1 - alpha) + v3 * alpha;
+
+            outptr[0] = v4 * (1 - beta) + v5 * beta;
+
+            outptr += 1;
+
+            fxptr += 1;
+            fyptr += 1;
+        }
+    }
+}
+
+int WarpConcat::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    int w = bottom_blobs[0].w;
+    int h = bottom_blobs[0].h;
+    size_t elemsize = bottom_blobs[0].elemsize;
+
+    int top_channels = 0;
+    size_t b = 0;
+    for (size_t i = 0; i < warped.size(); i++)
+    {
+        if (b + (warped[i] ? 2 : 1) > bottom_blobs.size())
+            return -1;
+
+        top_channels += bottom_blobs[b].c;
+        b += warped[i] ? 2 : 1;
+    }
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(w, h, top_channels, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    int q = 0;
+    b = 0;
+    for (size_t i = 0; i < warped.size(); i++)
+    {
+        const Mat& image_blob = bottom_blobs[b];
+        const int channels = image_blob.c;
+
+        if (warped[i])
+        {
+            const Mat& flow_blob = bottom_blobs[b + 1];
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int p = 0; p < channels; p++)
+            {
+                warp_channel(image_blob.channel(p), flow_blob, top_blob.channel(q + p));
+            }
+        }
+        else
+        {
+            for (int p = 0; p < channels; p++)
+            {
+                memcpy(top_blob.channel(q + p), image_blob.channel(p), w * h * elemsize);
+            }
+        }
+
+        q += channels;
+        b += warped[i] ? 2 : 1;
+    }
+
+    return 0;
+}
+
+void WarpConcat::record_slot(const VkMat& image_blob, const VkMat& flow_blob, bool warp, VkMat& top_blob, int offset, VkCompute& cmd) const
+{
+    std::vector<VkMat> bindings(3);
+    bindings[0] = image_blob;
+    bindings[1] = flow_blob;
+    bindings[2] = top_blob;
+
+    // each slot records the same constants every frame, so its shape gets specialized like any other
+    std::vector<vk_constant_type> constants(9);
+    constants[0].i = image_blob.w;
+    constants[1].i = image_blob.h;
+    constants[2].i = image_blob.c;
+    constants[3].i = image_blob.cstep;
+    constants[4].i = flow_blob.cstep;
+    constants[5].i = top_blob.cstep;
+    constants[6].i = top_blob.elempack;
+    constants[7].i = offset;
+    constants[8].i = warp ? 1 : 0;
+
+    const int elempack = image_blob.elempack;
+    if (elempack == 8)
+    {
+        cmd.record_pipeline(pipeline_warp_concat_pack8->get(constants), bindings, constants, image_blob);
+    }
+    else if (elempack == 4)
+    {
+        cmd.record_pipeline(pipeline_warp_concat_pack4->get(constants), bindings, constants, image_blob);
+    }
+    else // if (elempack == 1)
+    {
+        cmd.record_pipeline(pipeline_warp_concat->get(constants), bindings, constants, image_blob);
+    }
+}
+
+int WarpConcat::forward(const std::vector<VkMat>& bottom_blobs, std::vector<VkMat>& top_blobs, VkCompute& cmd, const Option& opt) const
+{
+    int w = bottom_blobs[0].w;
+    int h = bottom_blobs[0].h;
+
+    // pick the output packing the way Concat does
+    int top_channels = 0;
+    size_t b = 0;
+    for (size_t i = 0; i < warped.size(); i++)
+    {
+        if (b + (warped[i] ? 2 : 1) > bottom_blobs.size())
+            return -1;
+
+        top_channels += bottom_blobs[b].c * bottom_blobs[b].elempack;
+        b += warped[i] ? 2 : 1;
+    }
+
+    int out_elempack = opt.use_shader_pack8 && top_channels % 8 == 0 ? 8 : top_channels % 4 == 0 ? 4 : 1;
+
+    // the shaders store every channel on its own, which a packed output of fp16 halves packed into
+    // fp32 words cannot take
+    if (out_elempack != 1 && opt.use_fp16_packed && !opt.use_fp16_storage)
+    {
+        // warp into intermediate blobs and let Concat pack them
+        std::vector<VkMat> concat_bottoms(warped.size());
+
+        b = 0;
+        for (size_t i = 0; i < warped.size(); i++)
+        {
+            const VkMat& image_blob = bottom_blobs[b];
+
+            if (warped[i])
+            {
+                VkMat& warped_blob = concat_bottoms[i];
+                warped_blob.create(w, h, image_blob.c * image_blob.elempack, 4u, 1, opt.workspace_vkallocator);
+                if (warped_blob.empty())
+                    return -100;
+
+                record_slot(image_blob, bottom_blobs[b + 1], true, warped_blob, 0, cmd);
+            }
+            else
+            {
+                concat_bottoms[i] = image_blob;
+            }
+
+            b += warped[i] ? 2 : 1;
+        }
+
+        return concat->forward(concat_bottoms, top_blobs, cmd, opt);
+    }
+
+    size_t out_elemsize = opt.use_fp16_storage ? out_elempack * 2u : out_elempack * 4u;
+
+    VkMat& top_blob = top_blobs[0];
+    top_blob.create(w, h, top_channels / out_elempack, out_elemsize, out_elempack, opt.blob_vkallocator);
+    if (top_blob.empty())
+        return -100;
+
+    // every input is warped or copied straight into its channels of the output, whatever its packing
+    int offset = 0;
+    b = 0;
+    for (size_t i = 0; i < warped.size(); i++)
+    {
+        const VkMat& image_blob = bottom_blobs[b];
+
+        record_slot(image_blob, warped[i] ? bottom_blobs[b + 1] : image_blob, warped[i] != 0, top_blob, offset, cmd);
+
+        offset += image_blob.c * image_blob.elempack;
+        b += warped[i] ? 2 : 1;
+    }
+
+    return 0;
+}
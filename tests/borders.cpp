@@ -0,0 +1,211 @@
+// rife implemented with ncnn library
+
+// Detects the active picture of frames with letterbox and pillarbox bars of many sizes, against a plain
+// scan of every sample, and checks how areas are joined and aligned.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "rife_borders.h"
+#include "test.h"
+
+struct Frame
+{
+    int w;
+    int h;
+    int stride;
+    std::vector<float> r;
+    std::vector<float> g;
+    std::vector<float> b;
+};
+
+static float random_sample(float min, float max)
+{
+    return min + (max - min) * (rand() / static_cast<float>(RAND_MAX));
+}
+
+// bars of noise up to threshold around a picture of samples above it, in a random plane here and there
+static Frame make_frame(int w, int h, int stride, const RIFERect& picture, float threshold)
+{
+    Frame frame;
+    frame.w = w;
+    frame.h = h;
+    frame.stride = stride;
+    frame.r.assign(stride * h, 2.f);
+    frame.g.assign(stride * h, 2.f);
+    frame.b.assign(stride * h, 2.f);
+
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            const bool inside = x >= picture.x && x < picture.x + picture.w && y >= picture.y && y < picture.y + picture.h;
+            frame.r[y * stride + x] = random_sample(0.f, threshold);
+            frame.g[y * stride + x] = random_sample(0.f, threshold);
+            frame.b[y * stride + x] = random_sample(0.f, threshold);
+
+            // the edges of the picture light up in one plane only, the others stay dark
+            const bool edge = x == picture.x || x == picture.x + picture.w - 1 || y == picture.y || y == picture.y + picture.h - 1;
+            if (inside && (!edge || rand() % 3 == 0))
+            {
+                std::vector<float>& plane = rand() % 3 == 0 ? frame.r : rand() % 2 ? frame.g : frame.b;
+                plane[y * stride + x] = random_sample(threshold + 0.01f, 1.f);
+            }
+        }
+    }
+
+    return frame;
+}
+
+static RIFERect reference_area(const Frame& frame, float threshold)
+{
+    int x0 = frame.w;
+    int y0 = frame.h;
+    int x1 = 0;
+    int y1 = 0;
+    for (int y = 0; y < frame.h; y++)
+    {
+        for (int x = 0; x < frame.w; x++)
+        {
+            const int i = y * frame.stride + x;
+            if (frame.r[i] > threshold || frame.g[i] > threshold || frame.b[i] > threshold)
+            {
+                x0 = std::min(x0, x);
+                y0 = std::min(y0, y);
+                x1 = std::max(x1, x + 1);
+                y1 = std::max(y1, y + 1);
+            }
+        }
+    }
+
+    RIFERect area = {0, 0, 0, 0};
+    if (x1 > x0)
+    {
+        area.x = x0;
+        area.y = y0;
+        area.w = x1 - x0;
+        area.h = y1 - y0;
+    }
+
+    return area;
+}
+
+static bool same_area(const RIFERect& a, const RIFERect& b)
+{
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+static void test_detect()
+{
+    const float threshold = 0.05f;
+
+    // widths around the vector widths, so every tail of the scan is taken
+    const int widths[] = {1, 3, 4, 15, 16, 17, 33, 64, 67, 200};
+    for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++)
+    {
+        for (int n = 0; n < 50; n++)
+        {
+            const int w = widths[i];
+            const int h = 1 + rand() % 40;
+            const int stride = w + rand() % 5;
+
+            RIFERect picture;
+            picture.x = rand() % w;
+            picture.y = rand() % h;
+            picture.w = 1 + rand() % (w - picture.x);
+            picture.h = 1 + rand() % (h - picture.y);
+
+            const Frame frame = make_frame(w, h, stride, picture, threshold);
+            const RIFERect expected = reference_area(frame, threshold);
+            const RIFERect area = rife_detect_active_area(frame.r.data(), frame.g.data(), frame.b.data(), w, h, stride, threshold);
+            if (!same_area(area, expected))
+            {
+                fprintf(stderr, "%dx%d: detected %d,%d %dx%d instead of %d,%d %dx%d\n", w, h,
+                        area.x, area.y, area.w, area.h, expected.x, expected.y, expected.w, expected.h);
+                test_failures++;
+            }
+        }
+    }
+
+    // a black frame has no picture, a frame without bars is all picture
+    RIFERect none = {0, 0, 0, 0};
+    const Frame black = make_frame(37, 11, 40, none, threshold);
+    TEST_CHECK(rife_detect_active_area(black.r.data(), black.g.data(), black.b.data(), 37, 11, 40, threshold).empty());
+
+    RIFERect all = {0, 0, 37, 11};
+    const Frame full = make_frame(37, 11, 40, all, threshold);
+    const RIFERect area = rife_detect_active_area(full.r.data(), full.g.data(), full.b.data(), 37, 11, 40, threshold);
+    TEST_CHECK(same_area(area, reference_area(full, threshold)));
+}
+
+static void test_union()
+{
+    const RIFERect empty = {0, 0, 0, 0};
+    const RIFERect a = {10, 20, 30, 40};
+    const RIFERect b = {5, 50, 10, 20};
+
+    TEST_CHECK(same_area(rife_union_area(a, empty), a));
+    TEST_CHECK(same_area(rife_union_area(empty, b), b));
+    TEST_CHECK(rife_union_area(empty, empty).empty());
+
+    const RIFERect expected = {5, 20, 35, 50};
+    TEST_CHECK(same_area(rife_union_area(a, b), expected));
+    TEST_CHECK(same_area(rife_union_area(b, a), expected));
+}
+
+static void test_align()
+{
+    const RIFERect empty = {0, 0, 0, 0};
+    TEST_CHECK(rife_align_area(empty, 1920, 1080, 32).empty());
+
+    // grows around the center to multiples of the granularity
+    const RIFERect letterbox = {0, 138, 1920, 804};
+    const RIFERect aligned = rife_align_area(letterbox, 1920, 1080, 32);
+    const RIFERect expected = {0, 124, 1920, 832};
+    TEST_CHECK(same_area(aligned, expected));
+
+    // kept inside the frame at its edges
+    const RIFERect corner = {2, 1070, 10, 10};
+    const RIFERect shifted = rife_align_area(corner, 1920, 1080, 32);
+    TEST_CHECK(shifted.x == 0 && shifted.w == 32);
+    TEST_CHECK(shifted.y == 1080 - 32 && shifted.h == 32);
+
+    // never larger than the frame, even when it is not a multiple
+    const RIFERect wide = {1, 1, 1918, 1078};
+    const RIFERect whole = rife_align_area(wide, 1920, 1080, 64);
+    const RIFERect frame = {0, 0, 1920, 1080};
+    TEST_CHECK(same_area(whole, frame));
+
+    for (int n = 0; n < 1000; n++)
+    {
+        const int w = 1 + rand() % 300;
+        const int h = 1 + rand() % 300;
+        const int granularity = 1 << (rand() % 7);
+
+        RIFERect area;
+        area.x = rand() % w;
+        area.y = rand() % h;
+        area.w = 1 + rand() % (w - area.x);
+        area.h = 1 + rand() % (h - area.y);
+
+        const RIFERect a = rife_align_area(area, w, h, granularity);
+        TEST_CHECK(a.x >= 0 && a.y >= 0 && a.x + a.w <= w && a.y + a.h <= h);
+        TEST_CHECK(a.w % granularity == 0 || a.w == w);
+        TEST_CHECK(a.h % granularity == 0 || a.h == h);
+        TEST_CHECK(a.x <= area.x && a.y <= area.y && a.x + a.w >= area.x + area.w && a.y + a.h >= area.y + area.h);
+    }
+}
+
+int main()
+{
+    srand(1);
+
+    test_detect();
+    test_union();
+    test_align();
+
+    return test_failures;
+}
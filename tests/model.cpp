@@ -0,0 +1,341 @@
+// rife implemented with ncnn library
+
+// Parses model.json manifests, the valid ones and the ways they can be wrong, resolves which blobs the
+// flownet graphs of every v4 input arrangement are fed, and checks that the manifests shipped in every
+// model dir given on the command line describe the same model as the name of the dir does and that
+// their flownet is fed every input it declares.
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rife_model.h"
+#include "test.h"
+
+static bool same_model(const RIFEModelInfo& a, const RIFEModelInfo& b)
+{
+    bool same = a.rife_v2 == b.rife_v2 && a.rife_v4 == b.rife_v4 && a.padding == b.padding && a.scales == b.scales
+                && a.timestep == b.timestep && a.flownet_inputs == b.flownet_inputs
+                && a.flownet_in0 == b.flownet_in0 && a.flownet_in1 == b.flownet_in1 && a.flownet_timestep == b.flownet_timestep
+                && a.flownet_scale == b.flownet_scale && a.flownet_out == b.flownet_out
+                && a.contextnet_in == b.contextnet_in && a.contextnet_flow0 == b.contextnet_flow0 && a.contextnet_flow1 == b.contextnet_flow1
+                && a.fusionnet_in0 == b.fusionnet_in0 && a.fusionnet_in1 == b.fusionnet_in1 && a.fusionnet_flow == b.fusionnet_flow
+                && a.fusionnet_out == b.fusionnet_out;
+    for (int i = 0; i < 4; i++)
+    {
+        same = same && a.contextnet_out[i] == b.contextnet_out[i] && a.fusionnet_ctx0[i] == b.fusionnet_ctx0[i]
+               && a.fusionnet_ctx1[i] == b.fusionnet_ctx1[i];
+    }
+
+    return same;
+}
+
+static void test_defaults()
+{
+    RIFEModelInfo info;
+
+    TEST_CHECK(rife_model_defaults("rife", info) == 0);
+    TEST_CHECK(!info.rife_v2 && !info.rife_v4 && !info.timestep);
+    TEST_CHECK(info.contextnet_flow1 == "flow.1");
+    TEST_CHECK(info.flow_channels() == 2);
+
+    TEST_CHECK(rife_model_defaults("rife-v2", info) == 0);
+    TEST_CHECK(info.rife_v2 && !info.rife_v4);
+    TEST_CHECK(info.contextnet_flow1 == "flow.0");
+    TEST_CHECK(info.flow_channels() == 4);
+
+    TEST_CHECK(rife_model_defaults("rife-v3", info) == 0);
+    TEST_CHECK(info.rife_v2 && !info.rife_v4);
+
+    TEST_CHECK(rife_model_defaults("rife-v4", info) == 0);
+    TEST_CHECK(!info.rife_v2 && info.rife_v4 && info.timestep);
+    TEST_CHECK(info.flow_channels() == 0);
+    TEST_CHECK(info.supports_scale(1.f) && !info.supports_scale(0.5f));
+
+    TEST_CHECK(rife_model_defaults("rife-v5", info) != 0);
+}
+
+static void test_guess()
+{
+    RIFEModelInfo info;
+
+    TEST_CHECK(rife_model_guess("/models/rife-anime", info) == 0);
+    TEST_CHECK(!info.rife_v2 && !info.rife_v4);
+
+    TEST_CHECK(rife_model_guess("/models/rife-v2.4", info) == 0);
+    TEST_CHECK(info.rife_v2);
+
+    TEST_CHECK(rife_model_guess("/models/rife-v3.1", info) == 0);
+    TEST_CHECK(info.rife_v2);
+
+    TEST_CHECK(rife_model_guess("/models/rife-v4.6-lite", info) == 0);
+    TEST_CHECK(info.rife_v4);
+
+    TEST_CHECK(rife_model_guess("/models/dain", info) != 0);
+}
+
+static void test_parse()
+{
+    RIFEModelInfo info;
+
+    // the family alone gives its defaults
+    RIFEModelInfo defaults;
+    rife_model_defaults("rife-v2", defaults);
+    TEST_CHECK(rife_model_parse("{\"family\": \"rife-v2\"}", info) == 0);
+    TEST_CHECK(same_model(info, defaults));
+
+    TEST_CHECK(rife_model_parse(" {\n\t\"family\" : \"rife-v4\", \"padding\": 64, \"scales\": [1.0, 0.5, 0.25], \"timestep\": false,\n"
+                                " \"blobs\": {\"flownet\": {\"in0\": \"a\", \"in1\": \"b\", \"timestep\": \"t\", \"scale\": \"s\", \"out\": \"o\"}}} ",
+                                info)
+               == 0);
+    TEST_CHECK(info.rife_v4 && info.padding == 64 && !info.timestep);
+    TEST_CHECK(info.supports_scale(0.25f) && info.supports_scale(0.5f) && !info.supports_scale(2.f));
+    TEST_CHECK(info.flownet_in0 == "a" && info.flownet_in1 == "b" && info.flownet_timestep == "t");
+    TEST_CHECK(info.flownet_scale == "s" && info.flownet_out == "o");
+
+    TEST_CHECK(rife_model_parse("{\"family\": \"rife\", \"blobs\": {"
+                                "\"contextnet\": {\"in\": \"x\", \"flow1\": \"f\\\"1\", \"out\": [\"c1\", \"c2\", \"c3\", \"c4\"]},"
+                                "\"fusionnet\": {\"ctx0\": [\"0\", \"1\", \"2\", \"3\"], \"ctx1\": [\"4\", \"5\", \"6\", \"7\"], \"out\": \"y\"}}}",
+                                info)
+               == 0);
+    TEST_CHECK(info.contextnet_in == "x" && info.contextnet_flow1 == "f\"1" && info.contextnet_flow0 == "flow.0");
+    TEST_CHECK(info.contextnet_out[0] == "c1" && info.contextnet_out[3] == "c4");
+    TEST_CHECK(info.fusionnet_ctx0[2] == "2" && info.fusionnet_ctx1[1] == "5" && info.fusionnet_out == "y");
+    TEST_CHECK(info.fusionnet_in0 == "img0");
+
+    // unknown keys are left for later versions of the manifest
+    TEST_CHECK(rife_model_parse("{\"family\": \"rife\", \"license\": null, \"url\": \"https://example.com\"}", info) == 0);
+}
+
+static void test_parse_errors()
+{
+    RIFEModelInfo info;
+
+    const char* const invalid[] = {
+        "",
+        "{",
+        "[]",
+        "{\"family\": \"rife\",}",
+        "{\"family\": \"rife\"} trailing",
+        "{\"family\": \"rife\\u0041\"}",
+        "{}",
+        "{\"family\": 4}",
+        "{\"family\": \"rife-v9\"}",
+        "{\"family\": \"rife\", \"padding\": 0}",
+        "{\"family\": \"rife\", \"padding\": 1.5}",
+        "{\"family\": \"rife\", \"padding\": \"32\"}",
+        "{\"family\": \"rife\", \"scales\": []}",
+        "{\"family\": \"rife\", \"scales\": [1.0, -0.5]}",
+        "{\"family\": \"rife\", \"scales\": 1.0}",
+        "{\"family\": \"rife\", \"timestep\": 1}",
+        "{\"family\": \"rife\", \"timestep\": true}",
+        "{\"family\": \"rife\", \"blobs\": []}",
+        "{\"family\": \"rife\", \"blobs\": {\"flownet\": {\"out\": 0}}}",
+        "{\"family\": \"rife\", \"blobs\": {\"contextnet\": {\"out\": [\"1\", \"2\", \"3\"]}}}",
+        "{\"family\": \"rife\", \"blobs\": {\"fusionnet\": {\"ctx0\": [\"1\", \"2\", \"3\", 4]}}}",
+    };
+
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        if (rife_model_parse(invalid[i], info) == 0)
+        {
+            fprintf(stderr, "accepted %s\n", invalid[i]);
+            test_failures++;
+        }
+    }
+}
+
+// the arrangements of the frames and the timestep the v4.x lite graphs take
+static void test_inputs()
+{
+    RIFEModelInfo info;
+
+    TEST_CHECK(rife_model_parse("{\"family\": \"rife-v4\"}", info) == 0);
+    TEST_CHECK(info.flownet_inputs.empty());
+
+    const char* const arrangements[] = {"separate", "concat_images", "concat_all"};
+    for (size_t i = 0; i < sizeof(arrangements) / sizeof(arrangements[0]); i++)
+    {
+        const std::string json = std::string("{\"family\": \"rife-v4\", \"inputs\": \"") + arrangements[i] + "\"}";
+        TEST_CHECK(rife_model_parse(json.c_str(), info) == 0);
+        TEST_CHECK(info.flownet_inputs == arrangements[i]);
+    }
+
+    // a lite graph with the frames packed into in0 and a scale input of its own
+    TEST_CHECK(rife_model_parse("{\"family\": \"rife-v4\", \"inputs\": \"concat_all\", \"scales\": [1.0, 0.5],"
+                                " \"blobs\": {\"flownet\": {\"in0\": \"in0\", \"scale\": \"in1\"}}}",
+                                info)
+               == 0);
+    TEST_CHECK(info.flownet_inputs == "concat_all" && info.flownet_scale == "in1" && info.supports_scale(0.5f));
+
+    TEST_CHECK(rife_model_parse("{\"family\": \"rife-v4\", \"inputs\": \"interleaved\"}", info) != 0);
+    TEST_CHECK(rife_model_parse("{\"family\": \"rife-v4\", \"inputs\": 1}", info) != 0);
+    TEST_CHECK(rife_model_parse("{\"family\": \"rife-v2\", \"inputs\": \"separate\"}", info) != 0);
+}
+
+// the blobs the Input layers of an ncnn param graph produce, in the order the graph declares them
+static std::vector<std::string> graph_inputs(const std::string& param)
+{
+    std::istringstream iss(param);
+
+    int magic = 0;
+    int layer_count = 0;
+    int blob_count = 0;
+    iss >> magic >> layer_count >> blob_count;
+
+    std::vector<std::string> names;
+    std::string line;
+    while (std::getline(iss, line))
+    {
+        std::istringstream layer(line);
+
+        std::string type;
+        std::string name;
+        int bottom_count = 0;
+        int top_count = 0;
+        if (!(layer >> type >> name >> bottom_count >> top_count) || type != "Input")
+            continue;
+
+        std::string top;
+        layer >> top;
+        names.push_back(top);
+    }
+
+    return names;
+}
+
+static bool same_input(const RIFEFlownetInput& input, const char* blob, bool in0, bool in1, bool timestep, float scale)
+{
+    return input.blob == blob && input.in0 == in0 && input.in1 == in1 && input.timestep == timestep && input.scale == scale;
+}
+
+// which blobs of a small flownet graph per arrangement get the frames, the timestep plane and the scale
+static void test_resolve_inputs()
+{
+    RIFEModelInfo info;
+    std::vector<RIFEFlownetInput> inputs;
+
+    // the original v4 graph with a scale input
+    const std::string separate = "7767517\n"
+                                 "5 5\n"
+                                 "Input                    in0                      0 1 in0\n"
+                                 "Input                    in1                      0 1 in1\n"
+                                 "Input                    in2                      0 1 in2\n"
+                                 "Input                    in3                      0 1 in3\n"
+                                 "Concat                   cat_0                    4 1 in0 in1 in2 in3 out0\n";
+
+    TEST_CHECK(rife_model_defaults("rife-v4", info) == 0);
+    TEST_CHECK(rife_model_resolve_inputs(graph_inputs(separate), false, info, inputs) == 0);
+    TEST_CHECK(info.flownet_inputs == "separate" && info.flownet_scale == "in3");
+    TEST_CHECK(inputs.size() == 4);
+    if (inputs.size() == 4)
+    {
+        TEST_CHECK(same_input(inputs[0], "in0", true, false, false, 0.f));
+        TEST_CHECK(same_input(inputs[1], "in1", false, true, false, 0.f));
+        TEST_CHECK(same_input(inputs[2], "in2", false, false, true, 0.f));
+        TEST_CHECK(same_input(inputs[3], "in3", false, false, false, 1.f));
+    }
+
+    TEST_CHECK(rife_model_defaults("rife-v4", info) == 0);
+    TEST_CHECK(rife_model_resolve_inputs(graph_inputs(separate), true, info, inputs) == 0);
+    TEST_CHECK(inputs.size() == 4 && same_input(inputs.back(), "in3", false, false, false, 0.5f));
+
+    // a lite graph taking both frames in one blob next to the timestep plane
+    const std::string concat_images = "7767517\n"
+                                      "3 3\n"
+                                      "Input                    input                    0 1 input\n"
+                                      "Input                    in2                      0 1 in2\n"
+                                      "Concat                   cat_0                    2 1 input in2 out0\n";
+
+    TEST_CHECK(rife_model_defaults("rife-v4", info) == 0);
+    TEST_CHECK(rife_model_resolve_inputs(graph_inputs(concat_images), false, info, inputs) == 0);
+    TEST_CHECK(info.flownet_inputs == "concat_images" && info.flownet_in0 == "input" && info.flownet_scale.empty());
+    TEST_CHECK(inputs.size() == 2);
+    if (inputs.size() == 2)
+    {
+        TEST_CHECK(same_input(inputs[0], "input", true, true, false, 0.f));
+        TEST_CHECK(same_input(inputs[1], "in2", false, false, true, 0.f));
+    }
+
+    // without a scale input the graph cannot estimate the flow at half resolution
+    TEST_CHECK(rife_model_defaults("rife-v4", info) == 0);
+    TEST_CHECK(rife_model_resolve_inputs(graph_inputs(concat_images), true, info, inputs) != 0);
+
+    // a lite graph taking the frames and the timestep plane in one blob, with a scale input
+    const std::string concat_all = "7767517\n"
+                                   "3 3\n"
+                                   "Input                    input                    0 1 input\n"
+                                   "Input                    scale                    0 1 scale\n"
+                                   "BinaryOp                 mul_0                    2 1 input scale out0 0=2\n";
+
+    TEST_CHECK(rife_model_defaults("rife-v4", info) == 0);
+    TEST_CHECK(rife_model_resolve_inputs(graph_inputs(concat_all), true, info, inputs) == 0);
+    TEST_CHECK(info.flownet_inputs == "concat_all" && info.flownet_in0 == "input" && info.flownet_scale == "scale");
+    TEST_CHECK(inputs.size() == 2);
+    if (inputs.size() == 2)
+    {
+        TEST_CHECK(same_input(inputs[0], "input", true, true, true, 0.f));
+        TEST_CHECK(same_input(inputs[1], "scale", false, false, false, 0.5f));
+    }
+
+    // a manifest naming an arrangement the graph does not have
+    TEST_CHECK(rife_model_parse("{\"family\": \"rife-v4\", \"inputs\": \"separate\"}", info) == 0);
+    TEST_CHECK(rife_model_resolve_inputs(graph_inputs(concat_all), false, info, inputs) != 0);
+
+    // inputs left over that cannot all be the scale
+    const std::string unfed = "7767517\n"
+                              "4 4\n"
+                              "Input                    input                    0 1 input\n"
+                              "Input                    scale                    0 1 scale\n"
+                              "Input                    mask                     0 1 mask\n"
+                              "Concat                   cat_0                    3 1 input scale mask out0\n";
+
+    TEST_CHECK(rife_model_defaults("rife-v4", info) == 0);
+    TEST_CHECK(rife_model_resolve_inputs(graph_inputs(unfed), false, info, inputs) != 0);
+}
+
+int main(int argc, char** argv)
+{
+    test_defaults();
+    test_guess();
+    test_parse();
+    test_parse_errors();
+    test_inputs();
+    test_resolve_inputs();
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string modeldir = argv[i];
+
+        std::ifstream ifs(modeldir + "/model.json", std::ios::binary);
+        const std::string manifest = std::string(std::istreambuf_iterator<char>(ifs), {});
+
+        RIFEModelInfo parsed;
+        RIFEModelInfo guessed;
+        TEST_CHECK(!manifest.empty());
+        TEST_CHECK(rife_model_parse(manifest.c_str(), parsed) == 0);
+        TEST_CHECK(rife_model_guess(modeldir, guessed) == 0);
+        if (!same_model(parsed, guessed))
+        {
+            fprintf(stderr, "%s: model.json differs from the defaults of the dir name\n", modeldir.c_str());
+            test_failures++;
+        }
+
+        // the shipped flownet of a v4 model is fed every input it declares
+        if (parsed.rife_v4)
+        {
+            std::ifstream pfs(modeldir + "/flownet.param", std::ios::binary);
+            const std::vector<std::string> names = graph_inputs(std::string(std::istreambuf_iterator<char>(pfs), {}));
+
+            std::vector<RIFEFlownetInput> inputs;
+            TEST_CHECK(rife_model_resolve_inputs(names, false, parsed, inputs) == 0);
+            TEST_CHECK(inputs.size() == names.size());
+        }
+    }
+
+    return test_failures;
+}
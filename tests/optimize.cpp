@@ -0,0 +1,114 @@
+// rife implemented with ncnn library
+
+// Interpolates the same synthetic pair with every model dir given on the command line twice, once with
+// the graphs as shipped and once with the warps fused into the concats, and fails if the outputs differ
+// by more than the rounding of fp16 storage explains. Needs a Vulkan device, a software one such as lavapipe will do, and is
+// skipped without one.
+
+#include <math.h>
+#include <stdio.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// ncnn
+#include "gpu.h"
+
+#include "rife.h"
+#include "test.h"
+
+// largest difference of a sample and mean difference over the frame, in 0..1
+static const float max_tolerance = 4.f / 255;
+static const float mean_tolerance = 0.25f / 255;
+
+static const int width = 256;
+static const int height = 160;
+
+// smooth shapes moving a few pixels between the frames, so flownet has motion to estimate
+static void render(std::vector<float>& r, std::vector<float>& g, std::vector<float>& b, float shift)
+{
+    r.resize(width * height);
+    g.resize(width * height);
+    b.resize(width * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const float u = (x + shift) / width;
+            const float v = (y + shift * 0.5f) / height;
+            r[y * width + x] = 0.5f + 0.5f * sinf(u * 12.f) * cosf(v * 7.f);
+            g[y * width + x] = 0.5f + 0.4f * cosf(u * 5.f + v * 9.f);
+            b[y * width + x] = (x + y) % 64 < 32 ? 0.2f : 0.8f;
+        }
+    }
+}
+
+static int interpolate(const std::string& modeldir, const RIFEModelInfo& info, bool optimize, std::vector<float>& out)
+{
+    std::vector<float> r0, g0, b0, r1, g1, b1;
+    render(r0, g0, b0, 0.f);
+    render(r1, g1, b1, 6.f);
+
+    RIFE rife(ncnn::get_default_gpu_index(), info, false, false, 1, optimize);
+    if (rife.load(modeldir) != 0)
+        return -1;
+
+    out.resize(width * height * 3);
+    float* r = out.data();
+    float* g = r + width * height;
+    float* b = g + width * height;
+    return rife.process(r0.data(), g0.data(), b0.data(), r1.data(), g1.data(), b1.data(), r, g, b, width, height, width, 0.5f);
+}
+
+int main(int argc, char** argv)
+{
+    if (ncnn::create_gpu_instance() != 0 || ncnn::get_gpu_count() == 0)
+    {
+        fprintf(stderr, "no vulkan device, skipped\n");
+        return TEST_SKIP;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string modeldir = argv[i];
+
+        RIFEModelInfo info;
+        std::ifstream ifs(modeldir + "/model.json", std::ios::binary);
+        const std::string manifest = ifs.is_open() ? std::string(std::istreambuf_iterator<char>(ifs), {}) : "";
+        if (manifest.empty() ? rife_model_guess(modeldir, info) : rife_model_parse(manifest.c_str(), info))
+        {
+            fprintf(stderr, "%s: unknown model\n", modeldir.c_str());
+            test_failures++;
+            continue;
+        }
+
+        std::vector<float> shipped;
+        std::vector<float> optimized;
+        if (interpolate(modeldir, info, false, shipped) != 0 || interpolate(modeldir, info, true, optimized) != 0)
+        {
+            fprintf(stderr, "%s: failed to interpolate\n", modeldir.c_str());
+            test_failures++;
+            continue;
+        }
+
+        double sum = 0.0;
+        float max = 0.f;
+        for (size_t j = 0; j < shipped.size(); j++)
+        {
+            const float diff = fabsf(shipped[j] - optimized[j]);
+            sum += diff;
+            if (diff > max)
+                max = diff;
+        }
+        const float mean = static_cast<float>(sum / shipped.size());
+
+        printf("%s: max difference %g, mean %g\n", modeldir.c_str(), max, mean);
+        TEST_CHECK(max <= max_tolerance);
+        TEST_CHECK(mean <= mean_tolerance);
+    }
+
+    ncnn::destroy_gpu_instance();
+    return test_failures;
+}
@@ -0,0 +1,219 @@
+// rife implemented with ncnn library
+
+// Finds the changed regions of pairs of frames that differ in a few spots, in many, or not at all, and
+// checks that every changed sample is covered by a region, and that the regions are aligned, inside the
+// frame and apart from each other.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "rife_regions.h"
+#include "test.h"
+
+struct Pair
+{
+    int w;
+    int h;
+    int stride;
+    std::vector<float> planes[6];
+
+    Pair(int _w, int _h, int _stride)
+    {
+        w = _w;
+        h = _h;
+        stride = _stride;
+        for (int c = 0; c < 6; c++)
+        {
+            planes[c].resize(stride * h);
+            for (size_t i = 0; i < planes[c].size(); i++)
+                planes[c][i] = static_cast<float>((i * 31 + c * 7) % 97) / 97;
+        }
+
+        // the second frame starts as a copy of the first
+        for (int c = 0; c < 3; c++)
+            planes[c + 3] = planes[c];
+    }
+
+    void change(int x, int y, int c, float delta)
+    {
+        planes[c + 3][y * stride + x] += delta;
+    }
+
+    std::vector<RIFERect> regions(float threshold, int halo, int granularity) const
+    {
+        return rife_changed_regions(planes[0].data(), planes[1].data(), planes[2].data(),
+                                    planes[3].data(), planes[4].data(), planes[5].data(),
+                                    w, h, stride, threshold, halo, granularity);
+    }
+
+    bool changed(int x, int y, float threshold) const
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            const float d = planes[c][y * stride + x] - planes[c + 3][y * stride + x];
+            if (d > threshold || -d > threshold)
+                return true;
+        }
+
+        return false;
+    }
+};
+
+static bool contains(const RIFERect& r, int x, int y)
+{
+    return x >= r.x && x < r.x + r.w && y >= r.y && y < r.y + r.h;
+}
+
+static bool overlaps(const RIFERect& a, const RIFERect& b)
+{
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+// what holds for the regions of any pair
+static void check_regions(const Pair& pair, const std::vector<RIFERect>& regions, float threshold, int granularity)
+{
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        const RIFERect& r = regions[i];
+        TEST_CHECK(!r.empty());
+        TEST_CHECK(r.x >= 0 && r.y >= 0 && r.x + r.w <= pair.w && r.y + r.h <= pair.h);
+        TEST_CHECK(r.w % granularity == 0 || r.w == pair.w);
+        TEST_CHECK(r.h % granularity == 0 || r.h == pair.h);
+
+        for (size_t j = i + 1; j < regions.size(); j++)
+            TEST_CHECK(!overlaps(r, regions[j]));
+    }
+
+    for (int y = 0; y < pair.h; y++)
+    {
+        for (int x = 0; x < pair.w; x++)
+        {
+            if (!pair.changed(x, y, threshold))
+                continue;
+
+            bool covered = false;
+            for (size_t i = 0; i < regions.size() && !covered; i++)
+                covered = contains(regions[i], x, y);
+
+            if (!covered)
+            {
+                fprintf(stderr, "%dx%d: changed sample %d,%d outside every region\n", pair.w, pair.h, x, y);
+                test_failures++;
+                return;
+            }
+        }
+    }
+}
+
+static void test_identical()
+{
+    Pair pair(333, 200, 340);
+    TEST_CHECK(pair.regions(0.01f, 16, 32).empty());
+
+    // differences up to the threshold are noise
+    pair.change(10, 10, 0, 0.005f);
+    pair.change(300, 150, 2, -0.005f);
+    TEST_CHECK(pair.regions(0.01f, 16, 32).empty());
+}
+
+static void test_spots()
+{
+    const float threshold = 0.01f;
+    const int halo = 16;
+    const int granularity = 32;
+
+    // one spot gives one region around its block
+    {
+        Pair pair(1920, 1080, 1920);
+        pair.change(100, 100, 1, 0.5f);
+
+        const std::vector<RIFERect> regions = pair.regions(threshold, halo, granularity);
+        TEST_CHECK(regions.size() == 1);
+        TEST_CHECK(regions.size() == 1 && contains(regions[0], 64 - halo, 64 - halo) && contains(regions[0], 127 + halo, 127 + halo));
+        TEST_CHECK(regions.size() == 1 && regions[0].w < 256 && regions[0].h < 256);
+        check_regions(pair, regions, threshold, granularity);
+    }
+
+    // spots far apart give a region each
+    {
+        Pair pair(1920, 1080, 1920);
+        pair.change(100, 100, 0, 0.5f);
+        pair.change(1800, 1000, 2, -0.5f);
+
+        const std::vector<RIFERect> regions = pair.regions(threshold, halo, granularity);
+        TEST_CHECK(regions.size() == 2);
+        check_regions(pair, regions, threshold, granularity);
+    }
+
+    // spots in neighbouring blocks share a region
+    {
+        Pair pair(1920, 1080, 1920);
+        pair.change(100, 100, 0, 0.5f);
+        pair.change(140, 100, 0, 0.5f);
+
+        const std::vector<RIFERect> regions = pair.regions(threshold, halo, granularity);
+        TEST_CHECK(regions.size() == 1);
+        check_regions(pair, regions, threshold, granularity);
+    }
+
+    // too many spots are merged into one region
+    {
+        Pair pair(1920, 1080, 1920);
+        for (int i = 0; i < 8; i++)
+            pair.change(100 + i * 220, 500, 0, 0.5f);
+
+        const std::vector<RIFERect> regions = pair.regions(threshold, halo, granularity);
+        TEST_CHECK(regions.size() == 1);
+        check_regions(pair, regions, threshold, granularity);
+    }
+
+    // when the regions would cover most of the frame, it is taken whole
+    {
+        Pair pair(320, 240, 320);
+        pair.change(10, 10, 0, 0.5f);
+        pair.change(310, 230, 0, 0.5f);
+        pair.change(10, 230, 0, 0.5f);
+        pair.change(310, 10, 0, 0.5f);
+        pair.change(160, 120, 0, 0.5f);
+
+        const std::vector<RIFERect> regions = pair.regions(threshold, halo, granularity);
+        TEST_CHECK(regions.size() == 1);
+        TEST_CHECK(regions.size() == 1 && regions[0].x == 0 && regions[0].y == 0 && regions[0].w == 320 && regions[0].h == 240);
+    }
+}
+
+static void test_random()
+{
+    const float threshold = 0.01f;
+
+    for (int n = 0; n < 200; n++)
+    {
+        const int w = 1 + rand() % 500;
+        const int h = 1 + rand() % 300;
+        const int halo = rand() % 80;
+        const int granularity = 1 << (rand() % 7);
+
+        Pair pair(w, h, w + rand() % 7);
+        const int spots = rand() % 6;
+        for (int i = 0; i < spots; i++)
+            pair.change(rand() % w, rand() % h, rand() % 3, rand() % 2 ? 0.5f : -0.5f);
+
+        const std::vector<RIFERect> regions = pair.regions(threshold, halo, granularity);
+        TEST_CHECK(spots > 0 || regions.empty());
+        TEST_CHECK(spots == 0 || !regions.empty());
+        check_regions(pair, regions, threshold, granularity);
+    }
+}
+
+int main()
+{
+    srand(1);
+
+    test_identical();
+    test_spots();
+    test_random();
+
+    return test_failures;
+}
@@ -0,0 +1,147 @@
+// rife implemented with ncnn library
+
+// Reads timecode files, the valid ones and the ways they can be wrong, and maps target timelines onto
+// source ones: a constant rate onto another, a variable rate with a gap onto a constant one, and the
+// frames within the tolerance of a source frame, before the first and past the last.
+
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "rife_retime.h"
+#include "test.h"
+
+static std::filesystem::path write_file(const std::string& text)
+{
+    static int counter = 0;
+    const std::string name = "rife-retime-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+                             + "-" + std::to_string(counter++) + ".txt";
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+
+    std::ofstream ofs(path, std::ios::binary);
+    ofs << text;
+    return path;
+}
+
+static int read_text(const std::string& text, std::vector<double>& times)
+{
+    const std::filesystem::path path = write_file(text);
+    const int ret = rife_read_timecodes(path, times);
+    std::filesystem::remove(path);
+    return ret;
+}
+
+static bool near(double a, double b)
+{
+    return fabs(a - b) < 1e-9;
+}
+
+static void test_read_timecodes()
+{
+    std::vector<double> times;
+
+    TEST_CHECK(read_text("# timecode format v2\n0\n41.708\n\n# a comment\n  83.417\r\n125.125\n", times) == 0);
+    TEST_CHECK(times.size() == 4 && near(times[0], 0) && near(times[1], 0.041708) && near(times[2], 0.083417) && near(times[3], 0.125125));
+
+    // repeated times are a frame shown for no time, not a step back
+    TEST_CHECK(read_text("# timecode format v2\n0\n40\n40\n80\n", times) == 0);
+    TEST_CHECK(times.size() == 4);
+
+    TEST_CHECK(read_text("# timecode format v2\n", times) == 0);
+    TEST_CHECK(times.empty());
+
+    TEST_CHECK(read_text("# timecode format v1\nassume 23.976\n", times) != 0);
+    TEST_CHECK(read_text("0\n40\n", times) != 0);
+    TEST_CHECK(read_text("# timecode format v2\n0\n40\nabc\n", times) != 0);
+    TEST_CHECK(read_text("# timecode format v2\n0\n80\n40\n", times) != 0);
+
+    TEST_CHECK(rife_read_timecodes(std::filesystem::temp_directory_path() / "rife-retime-missing.txt", times) != 0);
+}
+
+static void test_constant_rates()
+{
+    // 24 fps onto 60 fps, every fifth target frame lands on every second source frame, up to the last
+    // source frame
+    std::vector<double> source(48);
+    for (size_t i = 0; i < source.size(); i++)
+        source[i] = i / 24.0;
+
+    std::vector<double> target(118);
+    for (size_t i = 0; i < target.size(); i++)
+        target[i] = i / 60.0;
+
+    const std::vector<RIFERetimedFrame> frames = rife_retime(source, target, 1e-6);
+    TEST_CHECK(frames.size() == target.size());
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        const double position = i * 24.0 / 60.0;
+        const int frame = static_cast<int>(floor(position + 1e-6));
+        const float timestep = static_cast<float>(position - frame);
+
+        TEST_CHECK(frames[i].frame == frame);
+        TEST_CHECK(fabsf(frames[i].timestep - (timestep < 1e-5f ? 0.f : timestep)) < 1e-5f);
+    }
+
+    // the same rate maps every frame onto itself
+    const std::vector<RIFERetimedFrame> same = rife_retime(source, source, 1e-6);
+    for (size_t i = 0; i < same.size(); i++)
+    {
+        TEST_CHECK(same[i].frame == static_cast<int>(i) && same[i].timestep == 0.f);
+    }
+}
+
+static void test_variable_rate()
+{
+    // 25 fps with a frame missing at 0.12, the gap is interpolated over
+    const std::vector<double> source = {0.0, 0.04, 0.08, 0.16, 0.2};
+    const std::vector<double> target = {0.0, 0.04, 0.08, 0.12, 0.16, 0.2};
+
+    const std::vector<RIFERetimedFrame> frames = rife_retime(source, target, 1e-4);
+    TEST_CHECK(frames[2].frame == 2 && frames[2].timestep == 0.f);
+    TEST_CHECK(frames[3].frame == 2 && fabsf(frames[3].timestep - 0.5f) < 1e-5f);
+    TEST_CHECK(frames[4].frame == 3 && frames[4].timestep == 0.f);
+    TEST_CHECK(frames[5].frame == 4 && frames[5].timestep == 0.f);
+}
+
+static void test_edges()
+{
+    const std::vector<double> source = {1.0, 2.0, 3.0};
+
+    // times within the tolerance of a frame copy it, from either side
+    const std::vector<RIFERetimedFrame> snapped = rife_retime(source, {1.005, 1.995, 2.5}, 0.01);
+    TEST_CHECK(snapped[0].frame == 0 && snapped[0].timestep == 0.f);
+    TEST_CHECK(snapped[1].frame == 1 && snapped[1].timestep == 0.f);
+    TEST_CHECK(snapped[2].frame == 1 && fabsf(snapped[2].timestep - 0.5f) < 1e-5f);
+
+    // times outside the source timeline copy its first or last frame
+    const std::vector<RIFERetimedFrame> outside = rife_retime(source, {0.0, 0.5, 3.0, 10.0}, 0.01);
+    TEST_CHECK(outside[0].frame == 0 && outside[0].timestep == 0.f);
+    TEST_CHECK(outside[1].frame == 0 && outside[1].timestep == 0.f);
+    TEST_CHECK(outside[2].frame == 2 && outside[2].timestep == 0.f);
+    TEST_CHECK(outside[3].frame == 2 && outside[3].timestep == 0.f);
+
+    // a source of a single frame
+    const std::vector<RIFERetimedFrame> single = rife_retime({0.5}, {0.0, 0.5, 1.0}, 0.01);
+    for (size_t i = 0; i < single.size(); i++)
+    {
+        TEST_CHECK(single[i].frame == 0 && single[i].timestep == 0.f);
+    }
+
+    TEST_CHECK(rife_retime(source, {}, 0.01).empty());
+}
+
+int main()
+{
+    test_read_timecodes();
+    test_constant_rates();
+    test_variable_rate();
+    test_edges();
+
+    return test_failures;
+}
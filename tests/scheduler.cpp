@@ -0,0 +1,186 @@
+// rife implemented with ncnn library
+
+// Queues jobs of several streams on a scheduler whose only slot is held, lets them go and checks the
+// order they ran in: streams take turns however many jobs each has waiting, a job of the size the slot
+// just ran goes first a few times in a row at most, several slots are never handed out twice, and the id of
+// a removed stream is reused.
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rife_scheduler.h"
+#include "test.h"
+
+struct Recorder
+{
+    std::mutex lock;
+    std::string order;
+};
+
+// a job that records its name when it gets the slot, the next job queues behind it
+static std::thread queue_job(RIFEScheduler& scheduler, int stream, int w, int h, char name, Recorder& recorder)
+{
+    std::thread job([&scheduler, stream, w, h, name, &recorder] {
+        int slot = scheduler.acquire(stream, w, h);
+        {
+            std::lock_guard<std::mutex> guard(recorder.lock);
+            recorder.order += name;
+        }
+        scheduler.release(slot);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return job;
+}
+
+static void test_turns()
+{
+    RIFEScheduler scheduler(1);
+    const int held = scheduler.add_stream();
+    const int a = scheduler.add_stream();
+    const int b = scheduler.add_stream();
+    const int c = scheduler.add_stream();
+
+    const int slot = scheduler.acquire(held, 64, 64);
+
+    Recorder recorder;
+    std::vector<std::thread> jobs;
+    jobs.push_back(queue_job(scheduler, a, 64, 64, 'a', recorder));
+    jobs.push_back(queue_job(scheduler, a, 64, 64, 'a', recorder));
+    jobs.push_back(queue_job(scheduler, a, 64, 64, 'a', recorder));
+    jobs.push_back(queue_job(scheduler, b, 64, 64, 'b', recorder));
+    jobs.push_back(queue_job(scheduler, c, 64, 64, 'c', recorder));
+
+    scheduler.release(slot);
+    for (auto& job : jobs)
+        job.join();
+
+    // the streams with a single job each do not wait behind every job of a
+    if (recorder.order != "abcaa")
+    {
+        fprintf(stderr, "jobs ran in the order %s instead of abcaa\n", recorder.order.c_str());
+        test_failures++;
+    }
+}
+
+static void test_same_size()
+{
+    RIFEScheduler scheduler(1);
+    const int held = scheduler.add_stream();
+    const int a = scheduler.add_stream();
+    const int b = scheduler.add_stream();
+
+    const int slot = scheduler.acquire(held, 64, 64);
+
+    Recorder recorder;
+    std::vector<std::thread> jobs;
+    jobs.push_back(queue_job(scheduler, b, 32, 32, 'b', recorder));
+    for (int i = 0; i < 5; i++)
+        jobs.push_back(queue_job(scheduler, a, 64, 64, 'a', recorder));
+
+    scheduler.release(slot);
+    for (auto& job : jobs)
+        job.join();
+
+    // the jobs of the size the slot ran go first, four of that size in a row counting the held one
+    if (recorder.order != "aaabaa")
+    {
+        fprintf(stderr, "jobs ran in the order %s instead of aaabaa\n", recorder.order.c_str());
+        test_failures++;
+    }
+}
+
+static void test_slots()
+{
+    const int slot_count = 3;
+    RIFEScheduler scheduler(slot_count);
+
+    std::atomic<int> busy[slot_count];
+    for (int i = 0; i < slot_count; i++)
+        busy[i] = 0;
+
+    std::atomic<int> running(0);
+    std::atomic<int> peak(0);
+    std::atomic<int> overlaps(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 12; t++)
+    {
+        const int stream = t < 6 ? scheduler.add_stream() : t - 6;
+        threads.emplace_back([&, stream, t] {
+            for (int i = 0; i < 200; i++)
+            {
+                const int size = 32 << ((t + i) % 3);
+                const int slot = scheduler.acquire(stream, size, size);
+                if (busy[slot]++ != 0)
+                    overlaps++;
+
+                const int now = ++running;
+                int seen = peak;
+                while (now > seen && !peak.compare_exchange_weak(seen, now))
+                {
+                }
+
+                std::this_thread::yield();
+
+                running--;
+                busy[slot]--;
+                scheduler.release(slot);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    TEST_CHECK(overlaps == 0);
+    TEST_CHECK(peak <= slot_count);
+}
+
+static void test_remove()
+{
+    RIFEScheduler scheduler(1);
+    const int held = scheduler.add_stream();
+    const int a = scheduler.add_stream();
+    const int b = scheduler.add_stream();
+
+    scheduler.remove_stream(a);
+    const int c = scheduler.add_stream();
+    TEST_CHECK(c == a);
+    TEST_CHECK(scheduler.add_stream() == b + 1);
+
+    // the reused stream takes its turn like any other
+    const int slot = scheduler.acquire(held, 64, 64);
+
+    Recorder recorder;
+    std::vector<std::thread> jobs;
+    jobs.push_back(queue_job(scheduler, c, 64, 64, 'c', recorder));
+    jobs.push_back(queue_job(scheduler, b, 64, 64, 'b', recorder));
+    jobs.push_back(queue_job(scheduler, c, 64, 64, 'c', recorder));
+
+    scheduler.release(slot);
+    for (auto& job : jobs)
+        job.join();
+
+    if (recorder.order != "cbc")
+    {
+        fprintf(stderr, "jobs ran in the order %s instead of cbc\n", recorder.order.c_str());
+        test_failures++;
+    }
+}
+
+int main()
+{
+    test_turns();
+    test_same_size();
+    test_slots();
+    test_remove();
+
+    return test_failures;
+}
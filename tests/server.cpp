@@ -0,0 +1,506 @@
+// rife implemented with ncnn library
+
+// Runs a server on a local socket with a model that blends the two frames instead of running the nets,
+// so only a cpu is needed, and checks the round trip of a job, clients in one process that number their
+// streams alike, the refusal of models that fail to load, the framing of the messages and that sizes a
+// client claims wrongly cannot take the server down.
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rife_server.h"
+#include "test.h"
+
+// the wire format as rife_server.cpp defines it
+static const int32_t protocol_version = 2;
+static const char protocol_magic[8] = {'R', 'I', 'F', 'E', 'S', 'R', 'V', '1'};
+
+struct HelloMessage
+{
+    char magic[8];
+    int32_t version;
+    int32_t embedded;
+    int32_t tta_mode;
+    int32_t uhd_mode;
+    int32_t optimize;
+    int32_t w;
+    int32_t h;
+    uint32_t modeldir_size;
+    uint32_t manifest_size;
+    int64_t client;
+};
+
+struct HelloReply
+{
+    int32_t status;
+    uint32_t message_size;
+    int64_t client;
+};
+
+struct JobMessage
+{
+    int64_t stream;
+    int32_t w;
+    int32_t h;
+    int32_t count;
+    int32_t new_segment;
+    uint64_t segment_size;
+};
+
+static std::atomic<int> loads(0);
+
+class BlendEngine : public RIFEServerEngine
+{
+public:
+    virtual int process_multi(const float* src0R, const float* src0G, const float* src0B,
+                              const float* src1R, const float* src1G, const float* src1B,
+                              float* const* dstR, float* const* dstG, float* const* dstB, const float* timesteps, const int count,
+                              const int w, const int h, const ptrdiff_t stride) const
+    {
+        const float* src0[3] = {src0R, src0G, src0B};
+        const float* src1[3] = {src1R, src1G, src1B};
+        for (int i = 0; i < count; i++)
+        {
+            float* dst[3] = {dstR[i], dstG[i], dstB[i]};
+            for (int c = 0; c < 3; c++)
+            {
+                for (int y = 0; y < h; y++)
+                {
+                    for (int x = 0; x < w; x++)
+                    {
+                        dst[c][y * stride + x] = src0[c][y * stride + x] * (1.f - timesteps[i]) + src1[c][y * stride + x] * timesteps[i];
+                    }
+                }
+            }
+        }
+
+        return 0;
+    }
+};
+
+static std::shared_ptr<RIFEServerEngine> load_model(const RIFEServerModel& model)
+{
+    loads++;
+    if (model.modeldir == "bad")
+        return 0;
+
+    return std::make_shared<BlendEngine>();
+}
+
+static RIFEServerModel make_model(const std::string& modeldir)
+{
+    RIFEServerModel model;
+    model.modeldir = modeldir;
+    model.embedded = false;
+    model.tta_mode = false;
+    model.uhd_mode = false;
+    model.optimize = false;
+    model.w = 0;
+    model.h = 0;
+    return model;
+}
+
+static int connect_socket(const std::string& socketpath)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socketpath.c_str(), socketpath.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd != -1 && connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// a hello for the model "good" on a connection of its own, returns the fd or -1
+static int open_raw(const std::string& socketpath)
+{
+    int fd = connect_socket(socketpath);
+    if (fd == -1)
+        return -1;
+
+    HelloMessage hello;
+    memset(&hello, 0, sizeof(hello));
+    memcpy(hello.magic, protocol_magic, sizeof(protocol_magic));
+    hello.version = protocol_version;
+    hello.modeldir_size = 4;
+
+    HelloReply reply;
+    if (send(fd, &hello, sizeof(hello), 0) != sizeof(hello) || send(fd, "good", 4, 0) != 4
+            || recv(fd, &reply, sizeof(reply), MSG_WAITALL) != sizeof(reply) || reply.status != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// sends a job, with the segment attached unless segment_fd is -1, returns the status or -2 if the server
+// closed the connection
+static int send_job(int fd, const JobMessage& job, const float* timesteps, int segment_fd)
+{
+    std::vector<char> message(sizeof(job) + job.count * sizeof(float));
+    memcpy(message.data(), &job, sizeof(job));
+    memcpy(message.data() + sizeof(job), timesteps, job.count * sizeof(float));
+
+    iovec iov;
+    iov.iov_base = message.data();
+    iov.iov_len = message.size();
+
+    union
+    {
+        cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (segment_fd != -1)
+    {
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &segment_fd, sizeof(int));
+    }
+
+    if (sendmsg(fd, &msg, 0) != static_cast<ssize_t>(message.size()))
+        return -2;
+
+    int32_t status;
+    if (recv(fd, &status, sizeof(status), MSG_WAITALL) != sizeof(status))
+        return -2;
+
+    return status;
+}
+
+// an unnamed file of size bytes to pass as a segment
+static int create_segment(const std::string& dir, size_t size)
+{
+    std::string path = dir + "/segment-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd == -1)
+        return -1;
+
+    unlink(path.c_str());
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// jobs of a stream of its own at a width of its own, counts the outputs that differ from the blend
+static int run_stream(RIFEClient& client, int t, int jobs)
+{
+    const int w = 19 + t;
+    const int h = 7;
+    const int stride = 48;
+
+    const int64_t stream = client.add_stream();
+    std::vector<float> src0(stride * h * 3);
+    std::vector<float> src1(src0.size());
+    std::vector<float> dst(src0.size() * 2);
+    for (size_t i = 0; i < src0.size(); i++)
+    {
+        src0[i] = static_cast<float>(i % 251) / 251;
+        src1[i] = static_cast<float>((i * 7 + t) % 241) / 241;
+    }
+
+    const int plane = stride * h;
+    float* dstR[2] = {&dst[0], &dst[plane * 3]};
+    float* dstG[2] = {&dst[plane], &dst[plane * 4]};
+    float* dstB[2] = {&dst[plane * 2], &dst[plane * 5]};
+    const float timesteps[2] = {0.25f, 0.75f};
+
+    int failures = 0;
+    for (int job = 0; job < jobs; job++)
+    {
+        if (client.process_multi(stream, &src0[0], &src0[plane], &src0[plane * 2], &src1[0], &src1[plane], &src1[plane * 2],
+                                 dstR, dstG, dstB, timesteps, 2, w, h, stride) != 0)
+        {
+            failures++;
+            continue;
+        }
+
+        for (int i = 0; i < 2; i++)
+        {
+            for (int y = 0; y < h; y++)
+            {
+                for (int x = 0; x < w; x++)
+                {
+                    const int j = y * stride + x;
+                    const float expected = src0[j] * (1.f - timesteps[i]) + src1[j] * timesteps[i];
+                    if (fabsf(dstR[i][j] - expected) > 1e-6f)
+                        failures++;
+                }
+            }
+        }
+    }
+
+    return failures;
+}
+
+static void test_round_trip(const std::string& socketpath)
+{
+    RIFEClient client(socketpath, make_model("good"));
+    std::string error;
+    TEST_CHECK(client.open(error) == 0);
+
+    // jobs of several streams and sizes at once, more than the server has slots
+    std::vector<std::thread> threads;
+    std::atomic<int> failures(0);
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&, t] { failures += run_stream(client, t, 20); });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    TEST_CHECK(failures == 0);
+}
+
+// two clients in one process, each numbers its streams from 0
+static void test_clients(const std::string& socketpath)
+{
+    for (int round = 0; round < 3; round++)
+    {
+        RIFEClient first(socketpath, make_model("good"));
+        RIFEClient second(socketpath, make_model("good"));
+        std::string error;
+        TEST_CHECK(first.open(error) == 0);
+        TEST_CHECK(second.open(error) == 0);
+
+        std::atomic<int> failures(0);
+        std::thread a([&] { failures += run_stream(first, 0, 20); });
+        std::thread b([&] { failures += run_stream(second, 1, 20); });
+        a.join();
+        b.join();
+
+        TEST_CHECK(failures == 0);
+    }
+}
+
+static void test_bad_model(const std::string& socketpath)
+{
+    RIFEClient client(socketpath, make_model("bad"));
+    std::string error;
+    TEST_CHECK(client.open(error) != 0);
+    TEST_CHECK(error.find("bad") != std::string::npos);
+
+    // a failed load is retried by the next client instead of being remembered
+    const int before = loads;
+    TEST_CHECK(client.open(error) != 0);
+    TEST_CHECK(loads == before + 1);
+}
+
+static void test_framing(const std::string& socketpath)
+{
+    // a wrong magic is dropped without an answer
+    {
+        int fd = connect_socket(socketpath);
+        TEST_CHECK(fd != -1);
+
+        HelloMessage hello;
+        memset(&hello, 0, sizeof(hello));
+        memcpy(hello.magic, "NOTRIFE!", 8);
+        hello.version = protocol_version;
+        send(fd, &hello, sizeof(hello), 0);
+
+        HelloReply reply;
+        TEST_CHECK(recv(fd, &reply, sizeof(reply), MSG_WAITALL) == 0);
+        close(fd);
+    }
+
+    // another version is refused with the reason
+    {
+        int fd = connect_socket(socketpath);
+        TEST_CHECK(fd != -1);
+
+        HelloMessage hello;
+        memset(&hello, 0, sizeof(hello));
+        memcpy(hello.magic, protocol_magic, sizeof(protocol_magic));
+        hello.version = protocol_version + 1;
+        send(fd, &hello, sizeof(hello), 0);
+
+        HelloReply reply;
+        TEST_CHECK(recv(fd, &reply, sizeof(reply), MSG_WAITALL) == sizeof(reply));
+        TEST_CHECK(reply.status != 0);
+        TEST_CHECK(reply.message_size > 0 && reply.message_size < 1024);
+
+        std::string message(reply.message_size, ' ');
+        TEST_CHECK(recv(fd, &message[0], message.size(), MSG_WAITALL) == static_cast<ssize_t>(message.size()));
+        TEST_CHECK(message.find("version") != std::string::npos);
+        close(fd);
+    }
+
+    // a client id the server never handed out is replaced
+    {
+        int fd = connect_socket(socketpath);
+        TEST_CHECK(fd != -1);
+
+        HelloMessage hello;
+        memset(&hello, 0, sizeof(hello));
+        memcpy(hello.magic, protocol_magic, sizeof(protocol_magic));
+        hello.version = protocol_version;
+        hello.modeldir_size = 4;
+        hello.client = int64_t(1) << 40;
+        send(fd, &hello, sizeof(hello), 0);
+        send(fd, "good", 4, 0);
+
+        HelloReply reply;
+        TEST_CHECK(recv(fd, &reply, sizeof(reply), MSG_WAITALL) == sizeof(reply));
+        TEST_CHECK(reply.status == 0);
+        TEST_CHECK(reply.client > 0 && reply.client != hello.client);
+        close(fd);
+    }
+
+    // a model dir longer than the server accepts
+    {
+        int fd = connect_socket(socketpath);
+        TEST_CHECK(fd != -1);
+
+        HelloMessage hello;
+        memset(&hello, 0, sizeof(hello));
+        memcpy(hello.magic, protocol_magic, sizeof(protocol_magic));
+        hello.version = protocol_version;
+        hello.modeldir_size = 1 << 30;
+        send(fd, &hello, sizeof(hello), 0);
+
+        HelloReply reply;
+        TEST_CHECK(recv(fd, &reply, sizeof(reply), MSG_WAITALL) == 0);
+        close(fd);
+    }
+}
+
+static void test_claimed_sizes(const std::string& socketpath, const std::string& dir)
+{
+    const float timesteps[2] = {0.5f, 0.5f};
+    const size_t size = rife_server_segment_size(16, 16, 1);
+    TEST_CHECK(size == 16 * 16 * 3 * 3 * sizeof(float));
+
+    // a segment larger than the object behind it, mapping it would raise SIGBUS
+    {
+        int fd = open_raw(socketpath);
+        int segment_fd = create_segment(dir, size);
+        TEST_CHECK(fd != -1 && segment_fd != -1);
+
+        JobMessage job = {0, 16, 16, 1, 1, size * 64};
+        TEST_CHECK(send_job(fd, job, timesteps, segment_fd) == -2);
+        close(segment_fd);
+        close(fd);
+    }
+
+    // a new segment without a descriptor
+    {
+        int fd = open_raw(socketpath);
+        TEST_CHECK(fd != -1);
+
+        JobMessage job = {0, 16, 16, 1, 1, size};
+        TEST_CHECK(send_job(fd, job, timesteps, -1) == -2);
+        close(fd);
+    }
+
+    // jobs not fitting the segment or the limits of the server fail, the connection stays usable
+    {
+        int fd = open_raw(socketpath);
+        int segment_fd = create_segment(dir, size);
+        TEST_CHECK(fd != -1 && segment_fd != -1);
+
+        JobMessage job = {0, 16, 16, 1, 1, size};
+        TEST_CHECK(send_job(fd, job, timesteps, segment_fd) == 0);
+        close(segment_fd);
+
+        JobMessage larger = {0, 16, 16, 2, 0, size};
+        TEST_CHECK(send_job(fd, larger, timesteps, -1) == -1);
+
+        JobMessage wider = {0, 1 << 20, 1 << 20, 1, 0, size};
+        TEST_CHECK(send_job(fd, wider, timesteps, -1) == -1);
+
+        JobMessage negative = {0, -16, 16, 1, 0, size};
+        TEST_CHECK(send_job(fd, negative, timesteps, -1) == -1);
+
+        JobMessage again = {0, 16, 16, 1, 0, size};
+        TEST_CHECK(send_job(fd, again, timesteps, -1) == 0);
+
+        // a count beyond the limit ends the connection, its timesteps cannot be skipped
+        JobMessage many = {0, 16, 16, 1 << 20, 0, size};
+        std::vector<float> more(1 << 20, 0.5f);
+        TEST_CHECK(send_job(fd, many, more.data(), -1) == -2);
+        close(fd);
+    }
+}
+
+int main()
+{
+    // the server answers connections the test already closed
+    signal(SIGPIPE, SIG_IGN);
+
+    char dir[] = "/tmp/rife-test-XXXXXX";
+    if (!mkdtemp(dir))
+    {
+        fprintf(stderr, "failed to create a directory for the socket\n");
+        return 1;
+    }
+    const std::string socketpath = std::string(dir) + "/socket";
+
+    // the server runs until the process ends
+    RIFEServer* server = new RIFEServer(2, load_model);
+    std::thread([server, socketpath] { server->run(socketpath); }).detach();
+
+    // wait until it listens
+    bool listening = false;
+    for (int i = 0; i < 500 && !listening; i++)
+    {
+        int fd = connect_socket(socketpath);
+        listening = fd != -1;
+        if (fd != -1)
+            close(fd);
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    TEST_CHECK(listening);
+
+    if (listening)
+    {
+        test_round_trip(socketpath);
+        test_clients(socketpath);
+        test_bad_model(socketpath);
+        test_framing(socketpath);
+        test_claimed_sizes(socketpath, dir);
+
+        // the server survived all of it
+        test_round_trip(socketpath);
+    }
+
+    unlink(socketpath.c_str());
+    rmdir(dir);
+    return test_failures;
+}
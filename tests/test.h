@@ -0,0 +1,23 @@
+// rife implemented with ncnn library
+
+#ifndef RIFE_TEST_H
+#define RIFE_TEST_H
+
+#include <stdio.h>
+
+// the number of failed checks is the exit status of a test, 77 tells meson it was skipped
+static int test_failures = 0;
+
+#define TEST_CHECK(cond)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++;                                                    \
+        }                                                                       \
+    } while (0)
+
+#define TEST_SKIP 77
+
+#endif // RIFE_TEST_H
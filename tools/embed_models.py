@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+# Compiles model directories into the plugin as read-only data.
+#
+# usage: embed_models.py <output.cpp> <model dir>...
+#
+# The .param graph and .bin weights of every net found in a model directory are written as byte
+# arrays, keyed by the directory name, and looked up at runtime through rife_find_embedded_net().
+# The weights are 4-byte aligned so that ncnn can reference them in place. A model.json manifest is
+# stored as an entry named "model.json" whose param holds the text and which has no weights.
+
+import os
+import sys
+
+NETS = ['flownet', 'contextnet', 'fusionnet']
+
+
+def identifier(model, net, ext):
+    return '{}_{}_{}'.format(''.join(c if c.isalnum() else '_' for c in model), net, ext)
+
+
+def write_array(out, decl, data):
+    out.write(decl + ' = {')
+    for i in range(0, len(data), 4096):
+        out.write(','.join('0x%02x' % b for b in data[i:i + 4096]))
+        out.write(',\n' if i + 4096 < len(data) else '')
+    out.write('};\n\n')
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit('usage: embed_models.py <output.cpp> <model dir>...')
+
+    entries = []
+
+    with open(sys.argv[1], 'w', newline='\n') as out:
+        out.write('// generated by embed_models.py, do not edit\n\n')
+        out.write('#include "rife_embedded.h"\n\n')
+        out.write('#include <string.h>\n\n')
+
+        for path in sys.argv[2:]:
+            model = os.path.basename(os.path.normpath(path))
+            found = False
+
+            for net in NETS:
+                param_path = os.path.join(path, net + '.param')
+                bin_path = os.path.join(path, net + '.bin')
+                if not os.path.exists(param_path):
+                    continue
+
+                with open(param_path, 'rb') as f:
+                    param = f.read() + b'\0'
+                with open(bin_path, 'rb') as f:
+                    weights = f.read()
+
+                param_id = identifier(model, net, 'param')
+                bin_id = identifier(model, net, 'bin')
+                write_array(out, 'static const char {}[]'.format(param_id), param)
+                write_array(out, 'alignas(4) static const unsigned char {}[]'.format(bin_id), weights)
+                entries.append((model, net, param_id, bin_id))
+                found = True
+
+            if not found:
+                sys.exit('{}: no flownet.param found'.format(path))
+
+            manifest_path = os.path.join(path, 'model.json')
+            if os.path.exists(manifest_path):
+                with open(manifest_path, 'rb') as f:
+                    manifest = f.read() + b'\0'
+
+                manifest_id = identifier(model, 'model', 'json')
+                write_array(out, 'static const char {}[]'.format(manifest_id), manifest)
+                entries.append((model, 'model.json', manifest_id, None))
+
+        out.write('static const rife_embedded_net rife_embedded_nets[] = {\n')
+        for model, net, param_id, bin_id in entries:
+            if bin_id:
+                out.write('    {{"{}", "{}", {}, {}, sizeof({})}},\n'.format(model, net, param_id, bin_id, bin_id))
+            else:
+                out.write('    {{"{}", "{}", {}, 0, 0}},\n'.format(model, net, param_id))
+        out.write('};\n\n')
+
+        out.write('const rife_embedded_net* rife_find_embedded_net(const char* model, const char* name)\n')
+        out.write('{\n')
+        out.write('    for (const rife_embedded_net& net : rife_embedded_nets)\n')
+        out.write('    {\n')
+        out.write('        if (strcmp(net.model, model) == 0 && strcmp(net.name, name) == 0)\n')
+        out.write('            return &net;\n')
+        out.write('    }\n\n')
+        out.write('    return 0;\n')
+        out.write('}\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+# Rewrites ncnn model weights in fp16.
+#
+# usage: fp16_model.py DIR...
+#        fp16_model.py --install DIR   (meson install script, DIR relative to the install prefix)
+#
+# Every <name>.bin next to a <name>.param found under DIR is converted in place. Raw fp32 weight
+# blobs are stored as fp16 with the tag ncnn's ModelBin recognizes, which halves their size while
+# the loader keeps working unchanged. Biases and PReLU slopes have no tag and stay fp32.
+
+import os
+import struct
+import sys
+
+FP16_TAG = 0x01306B47
+
+# layer type -> callable(params) returning the (count, tagged) weight blobs it loads, in order
+WEIGHTS = {
+    'Convolution': lambda p: [(int(p.get('6', 0)), True)] + ([(int(p.get('0', 0)), False)] if int(p.get('5', 0)) else []),
+    'Deconvolution': lambda p: [(int(p.get('6', 0)), True)] + ([(int(p.get('0', 0)), False)] if int(p.get('5', 0)) else []),
+    'InnerProduct': lambda p: [(int(p.get('2', 0)), True)] + ([(int(p.get('0', 0)), False)] if int(p.get('1', 0)) else []),
+    'PReLU': lambda p: [(int(p.get('0', 0)), False)],
+}
+
+# parameters that make the layers above load additional blobs this script does not know about
+UNSUPPORTED = {
+    'Convolution': {'8', '18'},
+    'Deconvolution': {'18'},
+    'InnerProduct': {'8'},
+    'PReLU': set(),
+}
+
+
+def align4(n):
+    return (n + 3) & ~3
+
+
+def to_fp16(data):
+    count = len(data) // 4
+    try:
+        import numpy
+        return numpy.frombuffer(data, dtype='<f4').astype('<f2').tobytes()
+    except ImportError:
+        return struct.pack('<%de' % count, *struct.unpack('<%df' % count, data))
+
+
+def read_layers(param_path):
+    with open(param_path, 'r') as f:
+        lines = f.read().split('\n')
+
+    if lines[0].strip() != '7767517':
+        raise ValueError('{}: not a text param file'.format(param_path))
+
+    layers = []
+    for line in lines[2:]:
+        fields = line.split()
+        if not fields:
+            continue
+
+        layer_type = fields[0]
+        bottom_count, top_count = int(fields[2]), int(fields[3])
+        params = dict(kv.split('=', 1) for kv in fields[4 + bottom_count + top_count:])
+        layers.append((layer_type, params))
+
+    return layers
+
+
+def convert(param_path, bin_path):
+    with open(bin_path, 'rb') as f:
+        data = f.read()
+
+    out = bytearray()
+    offset = 0
+    converted = False
+
+    for layer_type, params in read_layers(param_path):
+        if layer_type not in WEIGHTS:
+            continue
+
+        if UNSUPPORTED[layer_type] & params.keys():
+            raise ValueError('{}: {} with extra weight blobs is not supported'.format(param_path, layer_type))
+
+        for count, tagged in WEIGHTS[layer_type](params):
+            if not tagged:
+                out += data[offset:offset + count * 4]
+                offset += count * 4
+                continue
+
+            tag = struct.unpack_from('<I', data, offset)[0]
+            if tag == 0:
+                out += struct.pack('<I', FP16_TAG)
+                half = to_fp16(data[offset + 4:offset + 4 + count * 4])
+                out += half + b'\0' * (align4(len(half)) - len(half))
+                offset += 4 + count * 4
+                converted = True
+            elif tag == FP16_TAG:
+                size = 4 + align4(count * 2)
+                out += data[offset:offset + size]
+                offset += size
+            else:
+                raise ValueError('{}: quantized weights are not supported'.format(bin_path))
+
+    if offset != len(data):
+        raise ValueError('{}: weights do not match the graph ({} of {} bytes consumed)'.format(bin_path, offset, len(data)))
+
+    if converted:
+        tmp_path = bin_path + '.tmp'
+        with open(tmp_path, 'wb') as f:
+            f.write(out)
+        os.replace(tmp_path, bin_path)
+
+    return len(data), len(out)
+
+
+def convert_dir(path):
+    for root, _, files in os.walk(path):
+        for name in sorted(files):
+            if not name.endswith('.param'):
+                continue
+
+            param_path = os.path.join(root, name)
+            bin_path = param_path[:-len('.param')] + '.bin'
+            if not os.path.isfile(bin_path):
+                continue
+
+            before, after = convert(param_path, bin_path)
+            print('{}: {} -> {} bytes'.format(bin_path, before, after))
+
+
+def main():
+    args = sys.argv[1:]
+
+    if args and args[0] == '--install':
+        path = args[1]
+        if os.path.isabs(path):
+            path = os.environ.get('DESTDIR', '') + path
+        else:
+            path = os.path.join(os.environ['MESON_INSTALL_DESTDIR_PREFIX'], path)
+        args = [path]
+
+    if not args:
+        sys.exit('usage: fp16_model.py DIR...')
+
+    for path in args:
+        convert_dir(path)
+
+
+if __name__ == '__main__':
+    main()
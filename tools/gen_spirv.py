@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+# Compiles the embedded GLSL of the custom shaders to SPIR-V at build time.
+#
+# usage: gen_spirv.py <glslangValidator> <output.h> <shader.comp.hex.h>...
+#
+# Every shader is compiled once per storage variant that ncnn can select at runtime, with the
+# same macros ncnn's compile_spirv_module() would inject for that variant, and written to a
+# header that rife_spirv.cpp looks up by shader name and variant.
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+COMMON = [
+    ('psc(x)', '(x==0?p.x:x)'),
+]
+
+VARIANTS = {
+    'fp32': [
+        ('sfp', 'float'),
+        ('sfpvec2', 'vec2'),
+        ('sfpvec4', 'vec4'),
+        ('sfpvec8', 'mat2x4'),
+        ('afp', 'float'),
+        ('afpvec2', 'vec2'),
+        ('afpvec4', 'vec4'),
+        ('afpvec8', 'mat2x4'),
+        ('buffer_ld1(buf,i)', 'buf[i]'),
+        ('buffer_st1(buf,i,v)', '{buf[i]=v;}'),
+        ('buffer_ld2(buf,i)', 'buf[i]'),
+        ('buffer_st2(buf,i,v)', '{buf[i]=v;}'),
+        ('buffer_ld4(buf,i)', 'buf[i]'),
+        ('buffer_st4(buf,i,v)', '{buf[i]=v;}'),
+        ('buffer_ld8(buf,i)', 'buf[i]'),
+        ('buffer_st8(buf,i,v)', '{buf[i]=v;}'),
+    ],
+    'fp16p': [
+        ('NCNN_fp16_packed', '1'),
+        ('sfp', 'float'),
+        ('sfpvec2', 'uint'),
+        ('sfpvec4', 'uvec2'),
+        ('sfpvec8', 'uvec4'),
+        ('afp', 'float'),
+        ('afpvec2', 'vec2'),
+        ('afpvec4', 'vec4'),
+        ('afpvec8', 'mat2x4'),
+        ('buffer_ld1(buf,i)', 'buf[i]'),
+        ('buffer_st1(buf,i,v)', '{buf[i]=v;}'),
+        ('buffer_ld2(buf,i)', 'unpackHalf2x16(buf[i])'),
+        ('buffer_st2(buf,i,v)', '{buf[i]=packHalf2x16(v);}'),
+        ('buffer_ld4(buf,i)', 'vec4(unpackHalf2x16(buf[i].x),unpackHalf2x16(buf[i].y))'),
+        ('buffer_st4(buf,i,v)', '{buf[i]=uvec2(packHalf2x16(v.rg),packHalf2x16(v.ba));}'),
+        ('buffer_ld8(buf,i)', 'mat2x4(vec4(unpackHalf2x16(buf[i].r),unpackHalf2x16(buf[i].g)),vec4(unpackHalf2x16(buf[i].b),unpackHalf2x16(buf[i].a)))'),
+        ('buffer_st8(buf,i,v)', '{buf[i]=uvec4(uvec2(packHalf2x16(v[0].rg),packHalf2x16(v[0].ba)),uvec2(packHalf2x16(v[1].rg),packHalf2x16(v[1].ba)));}'),
+    ],
+    'fp16s': [
+        ('NCNN_fp16_packed', '1'),
+        ('NCNN_fp16_storage', '1'),
+        ('sfp', 'float16_t'),
+        ('sfpvec2', 'f16vec2'),
+        ('sfpvec4', 'f16vec4'),
+        ('sfpvec8', 'f16mat2x4'),
+        ('afp', 'float'),
+        ('afpvec2', 'vec2'),
+        ('afpvec4', 'vec4'),
+        ('afpvec8', 'mat2x4'),
+        ('buffer_ld1(buf,i)', 'float(buf[i])'),
+        ('buffer_st1(buf,i,v)', '{buf[i]=float16_t(v);}'),
+        ('buffer_ld2(buf,i)', 'vec2(buf[i])'),
+        ('buffer_st2(buf,i,v)', '{buf[i]=f16vec2(v);}'),
+        ('buffer_ld4(buf,i)', 'vec4(buf[i])'),
+        ('buffer_st4(buf,i,v)', '{buf[i]=f16vec4(v);}'),
+        ('buffer_ld8(buf,i)', 'mat2x4(vec4(buf[i][0]),vec4(buf[i][1]))'),
+        ('buffer_st8(buf,i,v)', '{buf[i]=f16mat2x4(f16vec4(v[0]),f16vec4(v[1]));}'),
+    ],
+}
+
+LOCAL_SIZE = 'layout (local_size_x_id = 233, local_size_y_id = 234, local_size_z_id = 235) in;\n'
+
+
+def read_glsl(path):
+    with open(path, 'r') as f:
+        data = f.read()
+    return bytes(int(x, 16) for x in re.findall(r'0x([0-9a-fA-F]{2})', data)).decode().replace('\r\n', '\n')
+
+
+def with_preamble(glsl, defines):
+    version, _, body = glsl.partition('\n')
+    preamble = ''.join('#define {} {}\n'.format(k, v) for k, v in COMMON + defines)
+    # extension directives in the body must precede any declaration, so the local size goes last
+    return version + '\n' + preamble + body + '\n' + LOCAL_SIZE
+
+
+def compile_spirv(glslang, glsl, tmpdir):
+    src = os.path.join(tmpdir, 'shader.comp')
+    spv = os.path.join(tmpdir, 'shader.spv')
+    with open(src, 'w') as f:
+        f.write(glsl)
+    subprocess.run([glslang, '-V', '--target-env', 'vulkan1.0', '-o', spv, src], check=True, stdout=subprocess.DEVNULL)
+    with open(spv, 'rb') as f:
+        data = f.read()
+    return [int.from_bytes(data[i:i + 4], 'little') for i in range(0, len(data), 4)]
+
+
+def main():
+    glslang, output, inputs = sys.argv[1], sys.argv[2], sys.argv[3:]
+
+    arrays = []
+    entries = []
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for path in inputs:
+            name = os.path.basename(path).split('.')[0]
+            glsl = read_glsl(path)
+
+            for variant, defines in VARIANTS.items():
+                words = compile_spirv(glslang, with_preamble(glsl, defines), tmpdir)
+                symbol = '{}_{}_spv_data'.format(name, variant)
+                arrays.append('static const uint32_t {}[] = {{{}}};\n'.format(symbol, ','.join('0x{:08x}'.format(w) for w in words)))
+                entries.append('    {{ "{}", "{}", {}, sizeof({}) }},\n'.format(name, variant, symbol, symbol))
+
+    with open(output, 'w') as f:
+        f.write('// generated by tools/gen_spirv.py, do not edit\n\n')
+        f.write('#include <cstddef>\n#include <cstdint>\n\n')
+        f.writelines(arrays)
+        f.write('\nstruct rife_spirv_entry\n{\n    const char* name;\n    const char* variant;\n    const uint32_t* data;\n    size_t size;\n};\n\n')
+        f.write('static const rife_spirv_entry rife_spirv_table[] = {\n')
+        f.writelines(entries)
+        f.write('};\n')
+
+
+if __name__ == '__main__':
+    main()